@@ -6,57 +6,185 @@
 #include <utility> 
 #include <memory> 
 #include <vector>   
+#include <mutex>
+#include <atomic>
+
+#include "gaussian_process.hpp"
+#include "thread_pool.hpp"
 
 using namespace std;
 using namespace Eigen;
 
+// kernel_type "gaussian" sums the kernel directly over every (point, sample)
+// pair in O(n m). "gaussian_binned" linearly bins the data onto grid_size
+// points, convolves with the kernel truncated at cutoff bandwidths via FFT and
+// interpolates back, in O(n + m + G log G); its error shrinks with the grid
+// spacing squared.
+//
+// "epanechnikov", "triweight" and "tricube" are compactly supported and exact.
+// The samples are sorted once and a two-pointer sweep over the sorted points
+// keeps running power sums of the samples inside the kernel window, so the
+// whole evaluation costs O((n + m) log(n + m)). For every kernel, bandwidth is
+// the kernel's standard deviation, so the same rule-of-thumb value can be
+// passed whichever kernel is selected.
 class KDE {
+public:
+    enum class Kernel { Gaussian, GaussianBinned, Epanechnikov, Triweight, Tricube };
+
+private:
     string kernel_type;
+    Kernel kernel;
+    int grid_size;
+    double cutoff;
+
+    static Kernel parse_kernel(const string& name);
+    VectorXd evaluate_binned(const VectorXd& data, double bandwidth, const VectorXd& points);
+
+    template <typename K>
+    VectorXd evaluate_window(const VectorXd& data, double bandwidth, const VectorXd& points);
 
 public:
-    KDE(string _kernel_type) : kernel_type(_kernel_type) {}
+    // Throws std::invalid_argument for an unknown kernel_type
+    KDE(string _kernel_type, int _grid_size = 2048, double _cutoff = 6.0)
+        : kernel_type(_kernel_type), kernel{parse_kernel(_kernel_type)},
+          grid_size{max(_grid_size, 2)}, cutoff{_cutoff} {}
 
     double gaussian_kernel(double u);
     VectorXd evaluate(const VectorXd& data, double bandwidth, const VectorXd& points);
 };
 
+// Implementations must tolerate concurrent calls: BayesOptimizer evaluates
+// batches of points on its thread pool
 class OptObjective {
 public:
     virtual double operator()(const VectorXd&, const MatrixXd& ) = 0;
+
+    // Drops anything derived from the returns of earlier calls. BayesOptimizer
+    // calls it at the start of every optimize(); anyone else calling the
+    // objective must call it whenever the returns change.
+    virtual void invalidate() {}
 };
 
+// Omega ratio of the portfolio return series. Built from a KDE it scores the
+// estimated density mass above vs. below zero, ignoring any threshold. Built
+// from a threshold it is the classical empirical Omega,
+// E[(r - tau)+] / E[(tau - r)+], computed in one O(T) pass with no density
+// estimate at all.
+//
+// With set_incremental(true) the objective remembers the last weights and
+// unnormalized portfolio returns, and moves to new weights by
+// rp += R_j^T dw_j over the changed assets only. A step that changes k
+// weights then costs O(k T) instead of O(N T), which is what coordinate-wise
+// searches need. Every refresh_interval updates (or when most weights changed)
+// rp is recomputed from scratch, so rounding drift cannot build up. The state
+// sits behind a try_lock: a call that finds another thread holding it computes
+// from scratch instead of waiting. The state is only checked against the shape
+// of the returns, so invalidate() must follow any change to their contents.
 class Omega : public OptObjective {
     KDE kernel_estimator;
+    bool empirical;
+    double threshold;
+
+    atomic<bool> incremental;
+    int refresh_interval;
+    mutex state_mutex;
+    bool state_valid;
+    Index state_rows, state_cols;   // shape of the returns the state was built from
+    VectorXd state_weights;         // unnormalized weights of the last call
+    VectorXd state_rp;              // asset_returns^T * state_weights
+    int updates_since_refresh;
+
+    // Unnormalized portfolio returns asset_returns^T * weights
+    VectorXd portfolio_returns(const VectorXd& weights, const MatrixXd& asset_returns);
 
 public:
-    Omega(const KDE& _kernel_estimator) : kernel_estimator{_kernel_estimator} {}
+    Omega(const KDE& _kernel_estimator)
+        : kernel_estimator{_kernel_estimator}, empirical{false}, threshold{0.0},
+          incremental{false}, refresh_interval{64}, state_valid{false},
+          state_rows{0}, state_cols{0}, updates_since_refresh{0} {}
+    Omega(double _threshold = 0.0)
+        : kernel_estimator{"gaussian"}, empirical{true}, threshold{_threshold},
+          incremental{false}, refresh_interval{64}, state_valid{false},
+          state_rows{0}, state_cols{0}, updates_since_refresh{0} {}
+
+    void set_incremental(bool enable, int _refresh_interval = 64);
+
+    // Forgets the incremental state; the next call recomputes from scratch
+    void invalidate() override;
 
     double omega_ratio_kde(const VectorXd& returns, const VectorXd& kde_values);
+
+    // Empirical Omega at a single threshold, O(T)
+    static double empirical_omega(const VectorXd& returns, double tau);
+
+    // Empirical Omega at every threshold from one sort and prefix sums,
+    // O((T + K) log T) for K thresholds
+    static VectorXd omega_curve(const VectorXd& returns, const VectorXd& thresholds);
+
     double operator()(const VectorXd& weights, const MatrixXd& asset_returns); 
 };
 
+// Acquisition functions, written for minimizing the objective. LogEI ranks like
+// EI but stays informative where EI underflows to zero far from the incumbent.
+enum class Acquisition { UCB, EI, PI, LogEI };
+
 class BayesOptimizer {
     std::unique_ptr<OptObjective> objective;
-    
-    double rbf_kernel(const VectorXd& x1, const VectorXd& x2, double length_scale = 1.0);
+    Acquisition acquisition;
+    int num_candidates;     // quasi-random simplex points scored per iteration
+    int num_restarts;       // best candidates refined by gradient ascent
+    int refit_interval;     // iterations between GP hyperparameter refits
+    int batch_size;         // points proposed and evaluated concurrently per iteration
+    int sparse_threshold;   // observations beyond which the exact GP is replaced by FITC
+    int num_inducing;       // inducing points of the sparse surrogate
+    uint64_t seed;          // Philox key of the random initial design
+    ThreadPool pool;
     
     // Acquisition function: Upper Confidence Bound (UCB)
-    double ucb(const VectorXd& mu, const VectorXd& sigma, double beta = 2.0); 
+    VectorXd ucb(const VectorXd& mu, const VectorXd& sigma, double beta = 2.0); 
+
+    // Acquisition function: Expected Improvement (EI) below best_value
+    VectorXd expected_improvement(const VectorXd& mu, const VectorXd& sigma, double best_value);
+
+    // Acquisition function: log EI, finite for arbitrarily small improvements
+    VectorXd log_expected_improvement(const VectorXd& mu, const VectorXd& sigma, double best_value);
+
+    // Acquisition function: Probability of Improvement (PI) below best_value
+    VectorXd probability_of_improvement(const VectorXd& mu, const VectorXd& sigma, double best_value);
+
+    // Scores candidates with the configured acquisition (larger is better)
+    VectorXd score(const VectorXd& mu, const VectorXd& sigma, double best_value);
 
-    // Computes the covariance matrix for GP
-    MatrixXd compute_covariance(const MatrixXd& X, double length_scale = 1.0);
+    // Acquisition value at x and its gradient from the analytic GP posterior gradients
+    double score_gradient(const Surrogate& gp, const VectorXd& x, double best_value, VectorXd& grad);
 
-    // GP posterior prediction
-    pair<VectorXd, VectorXd> gp_predict(
-        const MatrixXd& X_train, 
-        const VectorXd& y_train,
-        const VectorXd& x_new, 
-        double noise = 1e-6, 
-        double length_scale = 1.0); 
+    // Projected gradient ascent of the acquisition on the weight simplex
+    VectorXd refine(const Surrogate& gp, VectorXd x, double best_value);
 
+    // Quasi-random candidates on the simplex, then parallel multi-start refinement
+    VectorXd maximize_acquisition(const Surrogate& gp, const TrainingSet& observed,
+                                  double best_value, int iteration);
 
 public:
-    BayesOptimizer(std::unique_ptr<OptObjective> _objective) : objective(std::move(_objective)) {}
+    BayesOptimizer(std::unique_ptr<OptObjective> _objective,
+                   Acquisition _acquisition = Acquisition::UCB,
+                   int _num_candidates = 2048,
+                   int _num_restarts = 8,
+                   int _refit_interval = 5,
+                   int _batch_size = 1)
+        : objective(std::move(_objective)), acquisition{_acquisition},
+          num_candidates{_num_candidates}, num_restarts{_num_restarts},
+          refit_interval{_refit_interval}, batch_size{max(_batch_size, 1)},
+          sparse_threshold{2000}, num_inducing{256}, seed{42} {}
+
+    // Switch to a sparse surrogate once the training set reaches threshold points
+    void set_sparse_surrogate(int threshold, int inducing_points = 256) {
+        sparse_threshold = threshold;
+        num_inducing = inducing_points;
+    }
+
+    // Initial point i is drawn from Philox stream i under this key
+    void set_seed(uint64_t _seed) { seed = _seed; }
 
     // Bayesian Optimization using GP and UCB
     VectorXd optimize(const MatrixXd& asset_returns, int n_calls = 50);
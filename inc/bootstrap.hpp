@@ -0,0 +1,45 @@
+#ifndef __BOOTSTRAP_HPP__
+#define __BOOTSTRAP_HPP__
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <thread>
+
+#include "thread_pool.hpp"
+#include "monte_carlo.hpp"
+
+// Stationary: blocks of Geometric(1 / mean_block_length) length (Politis-Romano 1994).
+// Circular: blocks of fixed length round(mean_block_length) (Politis-Romano 1992).
+enum class BlockScheme { Stationary, Circular };
+
+// Historical block bootstrap of buy-and-hold terminal wealth. Paths are
+// strings of blocks of consecutive days, each block starting at a uniformly
+// drawn day and wrapping past the end of the sample. Whole days are resampled,
+// so the cross-asset dependence of each day is kept intact.
+//
+// The returns are copied day-major as cumulative log growth, T x N row-major
+// over two wrapped copies of the sample, so a block of any length is one
+// contiguous range and its growth is the difference of two gathered rows.
+// A path costs O(N) per block rather than per day. Paths are generated in
+// batches of batch_size on the pool, and batch b always draws from Philox
+// stream b under key seed, so results are bit-identical at any thread count.
+class BootstrapEngine {
+    using RowMatrixXd = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+    RowMatrixXd log_growth;     // (2T + 1) x N: row k = sum of log(1 + r) over days [0, k) mod T
+    int T;
+    double mean_block_length;
+    BlockScheme scheme;
+    int batch_size;
+    ThreadPool pool;
+
+public:
+    // asset_returns is N x T simple returns, as in Portfolio
+    BootstrapEngine(const Eigen::MatrixXd& asset_returns, double _mean_block_length = 20.0,
+                    BlockScheme _scheme = BlockScheme::Stationary, int _batch_size = 4096,
+                    size_t num_threads = std::thread::hardware_concurrency());
+
+    WealthStats simulate(const Eigen::VectorXd& weights, int64_t num_paths, int num_steps, uint64_t seed = 42);
+};
+
+#endif /* __BOOTSTRAP_HPP__ */
@@ -0,0 +1,148 @@
+#ifndef __GAUSSIAN_PROCESS_HPP__
+#define __GAUSSIAN_PROCESS_HPP__
+
+#include <Eigen/Dense>
+#include <utility>
+#include <memory>
+
+#include "thread_pool.hpp"
+#include "training_set.hpp"
+
+// GP posterior at a single point together with its input gradients
+struct GPPosterior {
+    double mu;
+    double sigma;
+    Eigen::VectorXd d_mu;
+    Eigen::VectorXd d_sigma;
+};
+
+// ARD squared-exponential kernel parameters
+struct GPHyperparameters {
+    Eigen::VectorXd length_scales;  // one per input dimension, or a single shared value
+    double signal_variance = 1.0;
+    double noise = 1e-6;
+};
+
+// Regression model used by BayesOptimizer to approximate the objective
+class Surrogate {
+public:
+    virtual ~Surrogate() = default;
+
+    virtual void fit(const TrainingSet& train) = 0;
+    virtual void add_observation(const Eigen::VectorXd& x_new, double y_new) = 0;
+
+    // Posterior (mean, standard deviation)
+    virtual std::pair<double, double> predict(const Eigen::VectorXd& x_new) const = 0;
+    virtual std::pair<Eigen::VectorXd, Eigen::VectorXd> predict_batch(const Eigen::MatrixXd& X_new) const = 0;
+    virtual GPPosterior predict_gradient(const Eigen::VectorXd& x_new) const = 0;
+
+    virtual void fit_hyperparameters(ThreadPool& pool, int num_restarts = 8, int max_iters = 100) = 0;
+    virtual const GPHyperparameters& hyperparameters() const = 0;
+    virtual void set_hyperparameters(const GPHyperparameters& _hyper) = 0;
+
+    virtual std::unique_ptr<Surrogate> clone() const = 0;
+    virtual const TrainingSet& training_set() const = 0;
+    virtual int size() const = 0;
+};
+
+// Exact GP regression with an ARD RBF kernel. The Cholesky factor of (K + noise I)
+// and alpha = (K + noise I)^-1 (y - y_mean) are kept between predictions, so
+// scoring a candidate costs O(n^2) and appending an observation extends the
+// factor in O(n^2) instead of refactorizing in O(n^3).
+class GaussianProcess : public Surrogate {
+    TrainingSet data;
+    double y_mean;              // constant prior mean, set by fit()
+    Eigen::MatrixXd L;          // lower Cholesky factor of K + noise I, capacity x capacity
+    Eigen::VectorXd alpha;
+    int n;
+    GPHyperparameters hyper;
+    Eigen::VectorXd inv_length_scales;
+
+    void reserve(int capacity);
+    void factorize();
+    void update_alpha();
+    Eigen::MatrixXd cross_kernel(const Eigen::MatrixXd& X_new) const;
+
+public:
+    GaussianProcess(double length_scale = 1.0, double noise = 1e-6) : y_mean{0.0}, n{0} {
+        hyper.length_scales = Eigen::VectorXd::Constant(1, length_scale);
+        hyper.noise = noise;
+    }
+
+    double kernel(const Eigen::Ref<const Eigen::VectorXd>& x1, const Eigen::Ref<const Eigen::VectorXd>& x2) const;
+
+    // Full O(n^3) factorization of the training set
+    void fit(const TrainingSet& train) override;
+
+    // Rank-one Cholesky extension with a new observation, O(n^2)
+    void add_observation(const Eigen::VectorXd& x_new, double y_new) override;
+
+    // GP posterior (mean, standard deviation) at x_new
+    std::pair<double, double> predict(const Eigen::VectorXd& x_new) const override;
+
+    // Batched GP posterior over the rows of an m x d candidate matrix. The
+    // cross-kernel comes from one GEMM squared-distance expansion and the
+    // variances from a single multi-right-hand-side triangular solve.
+    std::pair<Eigen::VectorXd, Eigen::VectorXd> predict_batch(const Eigen::MatrixXd& X_new) const override;
+
+    // Posterior mean/std and their analytic gradients with respect to x_new
+    GPPosterior predict_gradient(const Eigen::VectorXd& x_new) const override;
+
+    // Maximizes the log marginal likelihood over log length scales, signal
+    // variance and noise by gradient ascent, starting from the current values
+    // and num_restarts - 1 random points run concurrently on the pool, then
+    // refactorizes with the best hyperparameters found
+    void fit_hyperparameters(ThreadPool& pool, int num_restarts = 8, int max_iters = 100) override;
+
+    const GPHyperparameters& hyperparameters() const override { return hyper; }
+    void set_hyperparameters(const GPHyperparameters& _hyper) override;
+
+    std::unique_ptr<Surrogate> clone() const override { return std::make_unique<GaussianProcess>(*this); }
+    const TrainingSet& training_set() const override { return data; }
+    int size() const override { return n; }
+};
+
+// FITC sparse GP with m inducing points taken from the training inputs. Fitting
+// costs O(n m^2) and memory O(m^2); new observations are folded in with a
+// rank-one update of the m x m factor in O(m^2), leaving the inducing set fixed
+// until the next fit().
+class SparseGaussianProcess : public Surrogate {
+    TrainingSet data;
+    int num_inducing;
+    TrainingSet inducing;                   // inducing inputs and their observed targets
+    double y_mean;
+    Eigen::MatrixXd L_uu;                   // Cholesky factor of K_uu + jitter
+    Eigen::LLT<Eigen::MatrixXd> llt_B;      // B = I + V Lambda^-1 V^T, V = L_uu^-1 K_uf
+    Eigen::VectorXd b;                      // V Lambda^-1 (y - y_mean)
+    Eigen::VectorXd a;                      // L_uu^-T B^-1 b, so that mean(x) = y_mean + k_u(x)^T a
+    GPHyperparameters hyper;
+    Eigen::VectorXd inv_length_scales;
+
+    void select_inducing();
+    void update_weights();
+    Eigen::MatrixXd cross_kernel(const Eigen::MatrixXd& X_new) const;
+
+public:
+    SparseGaussianProcess(const GPHyperparameters& _hyper, int _num_inducing = 256)
+        : num_inducing{_num_inducing}, y_mean{0.0}, hyper{_hyper} {}
+
+    void fit(const TrainingSet& train) override;
+    void add_observation(const Eigen::VectorXd& x_new, double y_new) override;
+
+    std::pair<double, double> predict(const Eigen::VectorXd& x_new) const override;
+    std::pair<Eigen::VectorXd, Eigen::VectorXd> predict_batch(const Eigen::MatrixXd& X_new) const override;
+    GPPosterior predict_gradient(const Eigen::VectorXd& x_new) const override;
+
+    // Fits an exact GP on the inducing subset (O(m^3) per likelihood evaluation)
+    // and refits the sparse model with its hyperparameters
+    void fit_hyperparameters(ThreadPool& pool, int num_restarts = 8, int max_iters = 100) override;
+
+    const GPHyperparameters& hyperparameters() const override { return hyper; }
+    void set_hyperparameters(const GPHyperparameters& _hyper) override;
+
+    std::unique_ptr<Surrogate> clone() const override { return std::make_unique<SparseGaussianProcess>(*this); }
+    const TrainingSet& training_set() const override { return data; }
+    int size() const override { return data.size(); }
+};
+
+#endif /* __GAUSSIAN_PROCESS_HPP__ */
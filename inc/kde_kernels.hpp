@@ -0,0 +1,36 @@
+#ifndef __KDE_KERNELS_HPP__
+#define __KDE_KERNELS_HPP__
+
+#include <cmath>
+
+// Compactly supported KDE kernels, each a polynomial in |u| on [-1, 1]:
+// K(u) = sum_k coeffs[k] |u|^k. The windowed evaluator in KDE only needs the
+// coefficients, so a kernel is a compile-time table plus its standard
+// deviation, which converts a Gaussian-equivalent bandwidth into the support
+// radius.
+namespace KDEKernel
+{
+    struct Epanechnikov {
+        static constexpr int degree = 2;
+        static constexpr double coeffs[degree + 1] = {0.75, 0.0, -0.75};
+        static double std_dev() { return 1.0 / std::sqrt(5.0); }
+    };
+
+    struct Triweight {
+        static constexpr int degree = 6;
+        static constexpr double coeffs[degree + 1] = {
+            35.0 / 32, 0.0, -105.0 / 32, 0.0, 105.0 / 32, 0.0, -35.0 / 32
+        };
+        static double std_dev() { return 1.0 / 3.0; }
+    };
+
+    struct Tricube {
+        static constexpr int degree = 9;
+        static constexpr double coeffs[degree + 1] = {
+            70.0 / 81, 0.0, 0.0, -210.0 / 81, 0.0, 0.0, 210.0 / 81, 0.0, 0.0, -70.0 / 81
+        };
+        static double std_dev() { return std::sqrt(35.0 / 243.0); }
+    };
+}
+
+#endif /* __KDE_KERNELS_HPP__ */
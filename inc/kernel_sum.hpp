@@ -0,0 +1,17 @@
+#ifndef __KERNEL_SUM_HPP__
+#define __KERNEL_SUM_HPP__
+
+// Direct Gaussian kernel sums out[j] = sum_i exp(-0.5 ((points[j] - data[i]) * inv_bandwidth)^2)
+// for the exact KDE path. The widest available ISA (AVX-512F, AVX2+FMA, or
+// portable scalar code) is picked once at runtime. The SIMD paths use a
+// degree-11 polynomial exp with relative error below 1e-15 and walk the
+// operands in blocks that keep both in L1.
+namespace KernelSum
+{
+    void gaussian(const double *data, int n, const double *points, int m, double inv_bandwidth, double *out);
+
+    // Name of the instruction set selected by the dispatcher
+    const char *isa_name();
+}
+
+#endif /* __KERNEL_SUM_HPP__ */
@@ -4,6 +4,12 @@
 #include <vector>
 #include <Eigen/Dense>
 
+#include "omega_lp.hpp"
+#include "monte_carlo.hpp"
+#include "bootstrap.hpp"
+#include "risk_report.hpp"
+#include "portfolio_cloud.hpp"
+
 struct Market_Data {
     std::vector<double> returns;
     std::string ticker;
@@ -22,13 +28,45 @@ class Portfolio {
     Eigen::RowVectorXd mean; 
     Eigen::MatrixXd covariance;
     double sharpe_ratio;
+    OmegaLP omega_lp;       // keeps the last LP solution to warm-start the next one
 
 public:
-    Portfolio(std::vector<Market_Data> _assets);
+    // seed keys the Philox stream of the random initial weights
+    Portfolio(std::vector<Market_Data> _assets, uint64_t seed = 42);
 
     bool optimize_sharpe(uint32_t num_epochs = 50);
+
+    // Michaud resampling: re-solves the Sharpe ascent on the moments of
+    // num_resamples synthetic histories drawn from mean and covariance, each
+    // as long as the sample, and keeps the average of the allocations
+    bool optimize_sharpe_resampled(int num_resamples = 500, uint32_t num_epochs = 50, uint64_t seed = 42);
     void optimize_omega(uint32_t num_epochs = 50);
 
+    // Exact empirical Omega maximization by linear programming; sets the
+    // weights on success. Fails when no allocation beats threshold on average.
+    bool optimize_omega_lp(double threshold = 0.0);
+
+    // Monte Carlo terminal wealth and drawdowns of the current weights over
+    // num_steps days, with correlated daily returns drawn from mean and
+    // covariance, held or rebalanced back to the weights by the policy
+    WealthStats simulate(int64_t num_paths = 1000000, int num_steps = 252, uint64_t seed = 42,
+                         Sampler sampler = Sampler::PseudoRandom, const VarianceReduction& reduction = {},
+                         const RebalancePolicy& rebalance = {});
+
+    // Same, with paths resampled from the historical daily returns in blocks
+    WealthStats bootstrap(int64_t num_paths = 1000000, int num_steps = 252, double mean_block_length = 20.0,
+                          BlockScheme scheme = BlockScheme::Stationary, uint64_t seed = 42);
+
+    // VaR and expected shortfall of the current weights by every RiskMethod
+    RiskReport risk_report(const std::vector<int>& horizons = {1, 10, 21},
+                           const std::vector<double>& levels = {0.95, 0.99});
+
+    // Scores num_portfolios random Dirichlet(concentration) allocations,
+    // streams them to path unless it is empty and prints the best Sharpe and
+    // lowest volatility found
+    bool sample_cloud(const std::string& path, int64_t num_portfolios = 1000000,
+                      double concentration = 1.0, uint64_t seed = 42);
+
     void print_matricies();
     friend std::ostream& operator<<(std::ostream &os, const Portfolio &port);
 };
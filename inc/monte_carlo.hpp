@@ -0,0 +1,133 @@
+#ifndef __MONTE_CARLO_HPP__
+#define __MONTE_CARLO_HPP__
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.hpp"
+#include "tdigest.hpp"
+
+// Distribution of terminal wealth per unit invested. Quantiles, tail and
+// histogram come from a t-digest within its rank error bound (see TDigest);
+// the moments, extremes and path count are exact.
+struct WealthStats {
+    int64_t num_paths = 0;
+    double mean = 0.0;
+    double std_dev = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    Eigen::VectorXd quantile_levels;
+    Eigen::VectorXd quantiles;
+    double var_95 = 0.0;        // 1 - 5% quantile: loss not exceeded with 95% confidence
+    double cvar_95 = 0.0;       // expected loss in the worst 5% of paths
+    double prob_loss = 0.0;     // fraction of paths ending below the initial wealth
+    double mean_std_error = 0.0;        // standard error of mean
+    double variance_reduction = 1.0;    // plain MC variance of mean over that achieved
+    Eigen::VectorXd histogram_edges;    // equal bins between the 0.1% and 99.9% quantiles
+    Eigen::VectorXd histogram;          // estimated paths per bin
+
+    // Path-dependent metrics, filled by MonteCarloEngine only
+    double mean_max_drawdown = 0.0;     // per-path largest fall from a running peak, averaged
+    Eigen::VectorXd drawdown_quantiles; // of the per-path max drawdown, at quantile_levels
+    double mean_time_under_water = 0.0; // fraction of steps spent below the running peak
+    double mean_rebalances = 0.0;       // rebalancing trades per path
+    double mean_costs = 0.0;            // transaction costs paid, per unit of initial wealth
+
+    friend std::ostream& operator<<(std::ostream& os, const WealthStats& stats);
+};
+
+// Source of the standard normals driving the paths. Sobol draws each path's
+// N x num_steps normals from one Owen-scrambled Sobol point through the
+// inverse normal CDF, assigned by Brownian bridge so the leading dimensions
+// carry the terminal value and coarse shape of every asset's path.
+enum class Sampler { PseudoRandom, Sobol };
+
+// Variance reduction for pseudo-random runs; the techniques combine freely.
+//  - antithetic: each block's second half replays the first with negated normals
+//  - control_variate: regresses terminal wealth on X = sum_t w . r_t, whose mean
+//    num_steps * (mean . w) is known exactly, and removes the fitted part
+//  - stratified: draws the first principal component of the shocks with its
+//    path sum stratified, one path per stratum of a block (conditional on the
+//    sum S, the shocks are Y - mean(Y) + S / num_steps for fresh normals Y)
+// With any of them on, the path count is rounded up to whole blocks and the
+// mean's standard error comes from the spread of independent block means.
+struct VarianceReduction {
+    bool antithetic = false;
+    bool control_variate = false;
+    bool stratified = false;
+
+    bool any() const { return antithetic || control_variate || stratified; }
+};
+
+// Trading back to the target weights during a simulation.
+//  - None: buy and hold
+//  - Calendar: every `period` steps
+//  - Threshold: after any step where some asset's weight on a path has
+//    drifted more than `band` (absolute) from its target, for that path only
+// Trades cost `cost` per unit of value traded (0.001 = 10 bp), paid out of
+// the portfolio; the cost is charged on the trades to the pre-cost targets.
+// No trade happens after the final step.
+enum class Rebalance { None, Calendar, Threshold };
+
+struct RebalancePolicy {
+    Rebalance rule = Rebalance::None;
+    int period = 21;
+    double band = 0.05;
+    double cost = 0.0;
+};
+
+// Correlated multi-asset return paths r_t = mean + L z_t, with L the lower
+// Cholesky factor of the per-step covariance. Paths are simulated in blocks of
+// block_size: each step fills an N x B matrix of standard normals, applies L
+// to the whole block with one GEMM and compounds every asset's holding, so
+// per-path work is all dense array arithmetic. Each path's wealth, running
+// peak, max drawdown, steps under water and rebalancing costs sit in one lane
+// of 1 x B arrays allocated once per task and updated in place every step, so
+// the step loop does no heap allocation. Blocks are spread over the pool;
+// block b always draws from Philox stream b under key seed, so results are
+// bit-identical at any thread count.
+//
+// With Sampler::Sobol, block b takes Sobol points [b B, (b + 1) B), with B
+// reduced to keep a block's bridge within a few MB, and seed picks the
+// scramble. Dimensions past SobolSequence::max_dimensions() fall back to
+// pseudo-random normals; under the bridge ordering these are the finest
+// path details. Use a power-of-two path count to get the full QMC rate.
+class MonteCarloEngine {
+    Eigen::VectorXd mean;
+    Eigen::MatrixXd factor;     // N x N, factor * factor^T = covariance
+    Eigen::MatrixXd pc_factor;  // V sqrt(Lambda), principal components by decreasing variance
+    int block_size;
+    Sampler sampler;
+    VarianceReduction reduction;
+    RebalancePolicy rebalance;
+    ThreadPool pool;
+
+public:
+    MonteCarloEngine(const Eigen::VectorXd& _mean, const Eigen::MatrixXd& covariance,
+                     int _block_size = 1024, size_t num_threads = std::thread::hardware_concurrency());
+
+    void set_sampler(Sampler _sampler) { sampler = _sampler; }
+
+    // Only applies to Sampler::PseudoRandom
+    void set_variance_reduction(const VarianceReduction& _reduction) { reduction = _reduction; }
+
+    void set_rebalance(const RebalancePolicy& _rebalance) { rebalance = _rebalance; }
+
+    // Terminal wealth and drawdowns of a portfolio started at the given
+    // target weights and rebalanced by the policy, after num_steps periods,
+    // over num_paths paths
+    WealthStats simulate(const Eigen::VectorXd& weights, int64_t num_paths, int num_steps, uint64_t seed = 42);
+
+    // Paths are sketched per chunk of consecutive blocks, and the sketches
+    // merged in chunk order. The chunk count is fixed rather than tied to the
+    // pool, so the merged sketch is the same at any thread count.
+    static constexpr int64_t summary_chunks = 256;
+
+    // Summary statistics of a sketch of terminal wealths
+    static WealthStats summarize(const TDigest& digest);
+};
+
+#endif /* __MONTE_CARLO_HPP__ */
@@ -0,0 +1,111 @@
+#ifndef __NORMAL_DIST_HPP__
+#define __NORMAL_DIST_HPP__
+
+#include <cmath>
+#include <numbers>
+#include <Eigen/Dense>
+
+// Standard normal pdf/cdf over whole arrays. Everything is written as Eigen
+// array expressions, whose exp/log are SIMD-vectorized, with branches done
+// through select() so a batch never drops to scalar code.
+//
+// erfc uses the Chebyshev fit erfc(x) = t exp(-x^2 + P(t)), t = 1/(1 + x/2)
+// (Numerical Recipes erfcc), with fractional error below 1.2e-7 for every
+// x >= 0. Because the error is relative, tail probabilities keep ~7
+// significant digits instead of drowning in an absolute error bound.
+namespace Normal
+{
+    inline constexpr double inv_sqrt_2pi = 0.3989422804014327;
+
+    // exp(P(t)) where erfc(x) = t exp(-x^2) exp(P(t)) for x >= 0
+    inline Eigen::ArrayXd erfc_scaled_tail(const Eigen::ArrayXd& t)
+    {
+        Eigen::ArrayXd p = Eigen::ArrayXd::Constant(t.size(), 0.17087277);
+        p = -0.82215223 + t * p;
+        p = 1.48851587 + t * p;
+        p = -1.13520398 + t * p;
+        p = 0.27886807 + t * p;
+        p = -0.18628806 + t * p;
+        p = 0.09678418 + t * p;
+        p = 0.37409196 + t * p;
+        p = 1.00002368 + t * p;
+        p = -1.26551223 + t * p;
+        return p.exp();
+    }
+
+    inline Eigen::ArrayXd pdf(const Eigen::ArrayXd& z)
+    {
+        return inv_sqrt_2pi * (-0.5 * z.square()).exp();
+    }
+
+    // Phi(z) / phi(z) without exp underflow in the left tail (overflows for z > ~38)
+    inline Eigen::ArrayXd cdf_over_pdf(const Eigen::ArrayXd& z)
+    {
+        Eigen::ArrayXd x = z.abs() * std::numbers::sqrt2 * 0.5;
+        Eigen::ArrayXd t = 1.0 / (1.0 + 0.5 * x);
+        // Phi(-|z|) / phi(z) = 0.5 erfc(|z|/sqrt2) / phi(z)
+        Eigen::ArrayXd tail = (0.5 / inv_sqrt_2pi) * t * erfc_scaled_tail(t);
+        return (z <= 0).select(tail, 1.0 / pdf(z) - tail);
+    }
+
+    inline Eigen::ArrayXd cdf(const Eigen::ArrayXd& z)
+    {
+        Eigen::ArrayXd x = z.abs() * std::numbers::sqrt2 * 0.5;
+        Eigen::ArrayXd t = 1.0 / (1.0 + 0.5 * x);
+        Eigen::ArrayXd tail = 0.5 * t * (-x.square()).exp() * erfc_scaled_tail(t);
+        return (z <= 0).select(tail, 1.0 - tail);
+    }
+
+    // Quantile function by Acklam's rational approximations: one rational in
+    // p around the median and one in sqrt(-2 log p) for the tails, with
+    // relative error below 1.15e-9 over (0, 1)
+    inline Eigen::ArrayXd inv_cdf(const Eigen::ArrayXd& p)
+    {
+        Eigen::ArrayXd q = p - 0.5;
+        Eigen::ArrayXd r = q.square();
+        Eigen::ArrayXd central_num = ((((( -3.969683028665376e+01 * r + 2.209460984245205e+02) * r
+                                         - 2.759285104469687e+02) * r + 1.383577518672690e+02) * r
+                                         - 3.066479806614716e+01) * r + 2.506628277459239e+00) * q;
+        Eigen::ArrayXd central_den = ((((( -5.447609879822406e+01 * r + 1.615858368580409e+02) * r
+                                         - 1.556989798598866e+02) * r + 6.680131188771972e+01) * r
+                                         - 1.328068155288572e+01) * r + 1.0);
+
+        // Tail in the smaller of p and 1 - p, mirrored for the upper tail
+        Eigen::ArrayXd t = (-2.0 * p.min(1.0 - p).log()).sqrt();
+        Eigen::ArrayXd tail_num = ((((( -7.784894002430293e-03 * t - 3.223964580411365e-01) * t
+                                      - 2.400758277161838e+00) * t - 2.549732539343734e+00) * t
+                                      + 4.374664141464968e+00) * t + 2.938163982698783e+00);
+        Eigen::ArrayXd tail_den = (((( 7.784695709041462e-03 * t + 3.224671290700398e-01) * t
+                                     + 2.445134137142996e+00) * t + 3.754408661907416e+00) * t + 1.0);
+        Eigen::ArrayXd tail = tail_num / tail_den;
+
+        Eigen::ArrayXd x = central_num / central_den;
+        x = (p < 0.02425).select(tail, x);
+        x = (p > 1.0 - 0.02425).select(-tail, x);
+        return x;
+    }
+
+    // h(z) / phi(z) for z <= 0, with h(z) = z Phi(z) + phi(z) the EI of a
+    // unit-variance posterior. The direct form cancels as z -> -inf, amplifying
+    // the erfc error by ~z^2, so below z = -7 the asymptotic series
+    // r - 3r^2 + 15r^3 - ... - 10395r^6 (r = 1/z^2) takes over. The relative
+    // error stays below 1e-5 on both sides of the switch.
+    inline Eigen::ArrayXd ei_over_pdf(const Eigen::ArrayXd& z)
+    {
+        Eigen::ArrayXd direct = 1.0 + z * cdf_over_pdf(z);
+        Eigen::ArrayXd r = 1.0 / z.square();
+        Eigen::ArrayXd series = r * (1.0 + r * (-3.0 + r * (15.0 + r * (-105.0 + r * (945.0 - 10395.0 * r)))));
+        return (z < -7.0).select(series, direct);
+    }
+
+    // log h(z), finite for arbitrarily negative z
+    inline Eigen::ArrayXd log_ei(const Eigen::ArrayXd& z)
+    {
+        Eigen::ArrayXd z_neg = z.min(0.0);
+        Eigen::ArrayXd left = std::log(inv_sqrt_2pi) - 0.5 * z_neg.square() + ei_over_pdf(z_neg).log();
+        Eigen::ArrayXd right = (z * cdf(z) + pdf(z)).log();
+        return (z <= 0).select(left, right);
+    }
+}
+
+#endif /* __NORMAL_DIST_HPP__ */
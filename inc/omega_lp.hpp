@@ -0,0 +1,57 @@
+#ifndef __OMEGA_LP_HPP__
+#define __OMEGA_LP_HPP__
+
+#include <Eigen/Dense>
+
+// Exact maximizer of the empirical Omega ratio over long-only, fully invested
+// weights. With r_t = R_t w, Omega(w) = 1 + (mu w - tau) / E[(tau - r)+] is
+// linear-fractional, and the Charnes-Cooper substitution y = s w turns it into
+//
+//   max  mu y - tau s
+//   s.t. R_t y - tau s + e_t - z_t = 0     t = 1..T
+//        sum(y) - s = 0
+//        (1/T) sum(e) = 1
+//        y, s, e, z >= 0
+//
+// with w = y / s at the optimum. The substitution is only valid when some
+// portfolio beats the threshold on average (Omega > 1); otherwise solve()
+// returns false. It is solved by a Mehrotra predictor-corrector interior-point
+// method. The normal matrix A D A^T is diagonal plus the rank-(N + 1) term
+// G D G^T from the y and s columns, bordered by the two budget rows, so each
+// iteration is one O(T N^2) Woodbury factorization and a 2 x 2 Schur
+// complement, never a T x T factorization. The last solution is kept and used
+// to warm-start the next solve of the same shape (a rebalance over a rolling
+// window, or a threshold sweep).
+class OmegaLP {
+    double threshold;
+    double tolerance;
+    int max_iters;
+
+    // Previous primal (y, s, e, z), dual multipliers and reduced costs
+    Eigen::VectorXd x_prev;
+    Eigen::VectorXd lambda_prev;
+    Eigen::VectorXd s_prev;
+    int num_iters;
+    double omega_value;
+
+public:
+    OmegaLP(double _threshold = 0.0, double _tolerance = 1e-8, int _max_iters = 100)
+        : threshold{_threshold}, tolerance{_tolerance}, max_iters{_max_iters},
+          num_iters{0}, omega_value{0.0} {}
+
+    // Maximizes Omega for the N x T asset return matrix and writes the optimal
+    // weights. Returns false if no portfolio has mean return above the
+    // threshold, or the solver does not converge (e.g. Omega is unbounded
+    // because some portfolio never falls below the threshold).
+    bool solve(const Eigen::MatrixXd& asset_returns, Eigen::VectorXd& weights);
+
+    void set_threshold(double _threshold) { threshold = _threshold; }
+
+    // Drops the stored solution so the next solve starts cold
+    void reset() { x_prev.resize(0); lambda_prev.resize(0); s_prev.resize(0); }
+
+    double omega() const { return omega_value; }
+    int iterations() const { return num_iters; }
+};
+
+#endif /* __OMEGA_LP_HPP__ */
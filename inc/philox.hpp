@@ -0,0 +1,115 @@
+#ifndef __PHILOX_HPP__
+#define __PHILOX_HPP__
+
+#include <array>
+#include <cstdint>
+#include <Eigen/Dense>
+
+// Philox4x32-10 counter-based generator (Salmon, Moraes, Dror and Shaw, SC'11).
+// Each 128-bit output block is a pure function of a 64-bit key and a 128-bit
+// counter, here the seed and the pair (stream, counter). Nothing is carried
+// from one draw to the next, so any draw of any stream can be computed
+// directly. Work split over threads gives each independent unit (a simulation
+// block, an optimizer restart) its own stream, and the results are the same
+// bits whichever thread runs which unit.
+//
+// A stream is read as a sequence of 64-bit words, word k being the low or
+// high half of block k / 2. Uniforms take the top 53 bits of one word, as the
+// midpoint of their 2^-53 cell, so they lie strictly inside (0, 1). Normals
+// come in Box-Muller pairs from one block: normal k is the cosine (k even) or
+// sine (k odd) branch of block k / 2.
+//
+// Bulk block generation runs on the widest available ISA (AVX-512F, AVX2 or
+// scalar code, picked once at runtime); the rounds are integer-only, so every
+// path gives identical bits. Box-Muller is evaluated 8 blocks at a time on
+// fixed-size Eigen arrays, with sin/cos from Taylor polynomials after an exact
+// quarter-turn reduction, so single and bulk normals are the same lane
+// computation and agree bit for bit.
+namespace Philox
+{
+    using Block = std::array<uint32_t, 4>;
+
+    inline constexpr uint32_t mul_0 = 0xD2511F53u;
+    inline constexpr uint32_t mul_1 = 0xCD9E8D57u;
+    inline constexpr uint32_t weyl_0 = 0x9E3779B9u;
+    inline constexpr uint32_t weyl_1 = 0xBB67AE85u;
+
+    inline Block generate(uint64_t seed, uint64_t stream, uint64_t counter)
+    {
+        uint32_t x0 = (uint32_t)counter, x1 = (uint32_t)(counter >> 32);
+        uint32_t x2 = (uint32_t)stream, x3 = (uint32_t)(stream >> 32);
+        uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+        for (int round = 0; round < 10; ++round) {
+            uint64_t p0 = (uint64_t)mul_0 * x0;
+            uint64_t p1 = (uint64_t)mul_1 * x2;
+            x0 = (uint32_t)(p1 >> 32) ^ x1 ^ k0;
+            x1 = (uint32_t)p1;
+            x2 = (uint32_t)(p0 >> 32) ^ x3 ^ k1;
+            x3 = (uint32_t)p0;
+            k0 += weyl_0;
+            k1 += weyl_1;
+        }
+        return {x0, x1, x2, x3};
+    }
+
+    // Blocks first .. first + count - 1 as 2 count words: words[2 i] and
+    // words[2 i + 1] are the low and high halves of block first + i
+    void generate(uint64_t seed, uint64_t stream, uint64_t first, int64_t count, uint64_t *words);
+
+    // Word, uniform and normal at position index of a stream
+    inline uint64_t word(uint64_t seed, uint64_t stream, uint64_t index)
+    {
+        Block b = generate(seed, stream, index / 2);
+        return index % 2 ? b[2] | (uint64_t)b[3] << 32 : b[0] | (uint64_t)b[1] << 32;
+    }
+
+    inline double to_uniform(uint64_t w)
+    {
+        return ((w >> 11) + 0.5) * 0x1.0p-53;
+    }
+
+    inline double uniform(uint64_t seed, uint64_t stream, uint64_t index)
+    {
+        return to_uniform(word(seed, stream, index));
+    }
+
+    double normal(uint64_t seed, uint64_t stream, uint64_t index);
+
+    // Name of the instruction set selected for bulk generation
+    const char *isa_name();
+
+    // Sequential reader of one stream. Word and uniform draws take one word
+    // each. A run of normal draws starts on a block boundary unless it
+    // continues an earlier normal run, so a Box-Muller pair never shares a
+    // word with a uniform.
+    class Stream {
+        uint64_t seed, stream;
+        uint64_t position = 0;          // next word
+        bool pair_open = false;         // position is odd after a cosine branch
+        uint64_t cached_counter = ~0ull;
+        uint64_t cached_words[2];
+
+    public:
+        Stream(uint64_t _seed, uint64_t _stream, uint64_t _position = 0)
+            : seed{_seed}, stream{_stream}, position{_position} {}
+
+        uint64_t tell() const { return position; }
+        void seek(uint64_t _position) { position = _position; pair_open = false; }
+
+        uint64_t next_word();
+        double uniform() { return to_uniform(next_word()); }
+
+        // Uniform integer in [0, n) by multiply-high; the bias is below n / 2^64
+        uint64_t below(uint64_t n) { return (uint64_t)(((unsigned __int128)next_word() * n) >> 64); }
+
+        // Standard exponential by inversion
+        double exponential();
+
+        double normal();
+
+        void uniforms(double *out, Eigen::Index n);
+        void normals(double *out, Eigen::Index n);
+    };
+}
+
+#endif /* __PHILOX_HPP__ */
@@ -0,0 +1,57 @@
+#ifndef __PORTFOLIO_CLOUD_HPP__
+#define __PORTFOLIO_CLOUD_HPP__
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include "thread_pool.hpp"
+
+// Extremes of a sampled cloud, for checking optimizers against
+struct CloudSummary {
+    int64_t num_portfolios = 0;
+    double max_sharpe = 0.0;
+    Eigen::VectorXd max_sharpe_weights;
+    double min_volatility = 0.0;
+    Eigen::VectorXd min_volatility_weights;
+
+    friend std::ostream& operator<<(std::ostream& os, const CloudSummary& summary);
+};
+
+// Random long-only allocations drawn from a symmetric Dirichlet(concentration)
+// (normalized Gamma variates; concentration 1 is uniform on the simplex),
+// each scored by daily return w . mean, volatility sqrt(w' cov w) and their
+// ratio. Allocations are sampled and scored a tile of rows at a time: the
+// returns are one GEMV W mean^T, the variances the row sums of (W cov) .* W
+// with one GEMM, and the tile height keeps W, W cov and the tile's records
+// within a 256 KB L2. Tile t reads Philox stream t, so the cloud is the same
+// at any thread count.
+//
+// The file is a 24-byte header followed by one fixed-size record per
+// portfolio, in sample order:
+//   header: char magic[8] = "PFCLOUD1", uint32 num_assets, uint32 record_bytes,
+//           uint64 num_portfolios
+//   record: float32 return, volatility, sharpe, weights[num_assets]
+// all in native byte order. Each tile writes its records at their own offset,
+// so workers never wait on one another to append.
+class PortfolioCloud {
+    Eigen::RowVectorXd mean;
+    Eigen::MatrixXd covariance;
+    double concentration;
+    int tile_size;
+    ThreadPool pool;
+
+public:
+    // tile_size = 0 picks it from the cache budget
+    PortfolioCloud(const Eigen::RowVectorXd& _mean, const Eigen::MatrixXd& _covariance,
+                   double _concentration = 1.0, int _tile_size = 0,
+                   size_t num_threads = std::thread::hardware_concurrency());
+
+    // Samples num_portfolios allocations and streams them to path (skipped
+    // when path is empty). Fails if the file cannot be written.
+    bool generate(int64_t num_portfolios, const std::string& path, CloudSummary& summary, uint64_t seed = 42);
+};
+
+#endif /* __PORTFOLIO_CLOUD_HPP__ */
@@ -0,0 +1,75 @@
+#ifndef __RISK_REPORT_HPP__
+#define __RISK_REPORT_HPP__
+
+#include <Eigen/Dense>
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+//  - Historical: empirical tail of the overlapping h-day windows of the sample
+//  - Gaussian: normal with the daily mean and variance scaled by h
+//  - CornishFisher: the Gaussian quantile corrected for skewness and excess
+//    kurtosis, scaled as 1 / sqrt(h) and 1 / h for i.i.d. days
+//  - MonteCarlo: empirical tail of simulated correlated normal daily returns
+enum class RiskMethod { Historical, Gaussian, CornishFisher, MonteCarlo };
+
+inline constexpr int num_risk_methods = 4;
+
+// Value at risk and expected shortfall of buy-and-hold portfolios, as
+// positive fractions of the initial value, for every method, horizon and
+// confidence level. Row k of each matrix is portfolio k; column
+// h * levels.size() + l is horizons[h] days at confidence levels[l].
+struct RiskReport {
+    std::vector<int> horizons;
+    std::vector<double> levels;
+    Eigen::MatrixXd moments;    // K x 4: daily mean, std, skewness, excess kurtosis
+    std::array<Eigen::MatrixXd, num_risk_methods> var;
+    std::array<Eigen::MatrixXd, num_risk_methods> es;
+
+    double value_at_risk(RiskMethod method, int portfolio, int h, int l) const {
+        return var[(int)method](portfolio, h * levels.size() + l);
+    }
+    double expected_shortfall(RiskMethod method, int portfolio, int h, int l) const {
+        return es[(int)method](portfolio, h * levels.size() + l);
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const RiskReport& report);
+};
+
+// Risk of many candidate allocations against one returns sample. The
+// constructor turns the N x T daily returns into per-horizon sets of asset
+// h-day returns: the T - h + 1 overlapping historical windows, and
+// num_scenarios simulated paths compounded to each horizon (Philox stream b
+// for scenario block b, so the set does not depend on the thread count).
+//
+// evaluate() splits the candidates into chunks over the pool. A chunk's
+// portfolio returns over every set come from one GEMM per set, sample-major
+// so each portfolio's sample is contiguous. Tails are then found by
+// nth_element at decreasing tail sizes, each level only partitioning what
+// the previous one left below its quantile, so nothing is ever fully sorted.
+class RiskEngine {
+    std::vector<int> horizons;
+    std::vector<double> levels;
+    std::vector<int> level_order;               // level indices by decreasing tail size
+    Eigen::MatrixXd returns;                    // N x T
+    std::vector<Eigen::MatrixXd> historical;    // per horizon, N x (T - h + 1) window returns
+    std::vector<Eigen::MatrixXd> simulated;     // per horizon, N x num_scenarios
+    int chunk_size;
+    ThreadPool pool;
+
+public:
+    // asset_returns is N x T simple returns, as in Portfolio
+    RiskEngine(const Eigen::MatrixXd& asset_returns, std::vector<int> _horizons = {1, 10, 21},
+               std::vector<double> _levels = {0.95, 0.99}, int64_t num_scenarios = 100000,
+               uint64_t seed = 42, int _chunk_size = 16,
+               size_t num_threads = std::thread::hardware_concurrency());
+
+    // candidates is K x N, one allocation per row
+    RiskReport evaluate(const Eigen::MatrixXd& candidates);
+};
+
+#endif /* __RISK_REPORT_HPP__ */
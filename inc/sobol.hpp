@@ -0,0 +1,39 @@
+#ifndef __SOBOL_HPP__
+#define __SOBOL_HPP__
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <vector>
+
+// Owen-scrambled Sobol points in [0, 1)^dims.
+//
+// Dimension 0 is the van der Corput sequence; dimension j > 0 takes its
+// primitive polynomial and initial direction numbers from the Joe-Kuo
+// new-joe-kuo-6.21201 table (max_dimensions() = 3667), chosen so the
+// two-dimensional projections have small t-values. Scrambling keeps every
+// projection's t-value, so it randomizes the points but cannot repair a
+// weak pair; the leading dimensions, which the Brownian bridge gives to the
+// terminal values, are where the table matters most.
+//
+// Scrambling is the hash-based nested uniform (Owen) scramble of Laine and
+// Karras as reformulated by Burley (2020), seeded per dimension, so distinct
+// seeds give independent randomized QMC replicates for error estimates.
+class SobolSequence {
+    int dims;
+    std::vector<uint32_t> directions;   // dims x 32, direction v_k of dimension j at j * 32 + k
+    std::vector<uint32_t> scramble_seeds;
+
+public:
+    SobolSequence(int _dims, uint64_t seed = 0);
+
+    static int max_dimensions();
+    int dimensions() const { return dims; }
+
+    // Points first .. first + count - 1 in Gray-code order into the rows of
+    // U (dims x count, row-major). Gray-code order visits the same set as the
+    // natural order over any aligned power-of-two range.
+    void generate(uint64_t first, int count,
+                  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>& U) const;
+};
+
+#endif /* __SOBOL_HPP__ */
@@ -0,0 +1,18 @@
+#ifndef __SOBOL_JOE_KUO_HPP__
+#define __SOBOL_JOE_KUO_HPP__
+
+#include <cstdint>
+
+// Primitive polynomials and initial direction numbers of S. Joe and F. Y. Kuo,
+// "Constructing Sobol sequences with better two-dimensional projections",
+// SIAM J. Sci. Comput. 30 (2008), file new-joe-kuo-6.21201, for Sobol
+// dimensions 2 .. 1 + dimensions (every polynomial below 2^16). Records are
+// packed back to back as s, a, m_1 .. m_s, in the file's own encoding: the
+// polynomial is x^s + a_1 x^(s-1) + ... + a_(s-1) x + 1 with a_1 the highest
+// of the s - 1 bits of a.
+namespace JoeKuo {
+    inline constexpr int dimensions = 3666;
+    extern const uint16_t table[];
+}
+
+#endif /* __SOBOL_JOE_KUO_HPP__ */
@@ -0,0 +1,182 @@
+#ifndef __THREAD_POOL_HPP__
+#define __THREAD_POOL_HPP__
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <algorithm>
+
+// Fixed-size work-stealing pool. Every worker owns a deque: tasks submitted
+// from a worker go to the back of its own deque and are taken back LIFO, so
+// recently produced work stays in that core's cache, while an idle worker
+// steals from the front of the others'. Tasks from outside the pool are
+// dealt round-robin over the deques.
+//
+// worker_index() names the calling worker, so a parallel loop can give each
+// worker its own scratch buffers, sized size() and indexed without locking.
+class ThreadPool {
+    struct WorkQueue {
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queued{0};          // pushed but not yet taken
+    std::atomic<size_t> next_queue{0};      // round-robin target for outside submissions
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;
+    bool stopping;
+
+    static inline thread_local const ThreadPool *current_pool = nullptr;
+    static inline thread_local size_t current_worker = 0;
+
+    void push(std::function<void()> task) {
+        size_t target = current_pool == this ? current_worker : next_queue++ % queues.size();
+        // Counted before it is visible, so a thief never takes an uncounted task
+        ++queued;
+        {
+            std::lock_guard<std::mutex> lock(queues[target]->mutex);
+            queues[target]->tasks.push_back(std::move(task));
+        }
+        // Taking the sleep lock orders the push before any sleeper's predicate check
+        { std::lock_guard<std::mutex> lock(sleep_mutex); }
+        sleep_cv.notify_one();
+    }
+
+    // Own deque from the back, then the others' from the front
+    bool try_pop(size_t self, std::function<void()>& task) {
+        for (size_t k = 0; k < queues.size(); ++k) {
+            WorkQueue& queue = *queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty()) continue;
+            if (k == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            } else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+            --queued;
+            return true;
+        }
+        return false;
+    }
+
+    void worker_loop(size_t self) {
+        current_pool = this;
+        current_worker = self;
+        std::function<void()> task;
+        while (true) {
+            if (try_pop(self, task)) {
+                task();
+                task = nullptr;
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            sleep_cv.wait(lock, [this] { return stopping || queued.load() > 0; });
+            if (stopping && queued.load() == 0) return;
+        }
+    }
+
+public:
+    ThreadPool(size_t num_threads = std::thread::hardware_concurrency()) : stopping{false} {
+        num_threads = std::max<size_t>(num_threads, 1);
+        for (size_t i = 0; i < num_threads; ++i) queues.push_back(std::make_unique<WorkQueue>());
+        for (size_t i = 0; i < num_threads; ++i) {
+            workers.emplace_back([this, i] { worker_loop(i); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        sleep_cv.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size(); }
+
+    // Index in [0, size()) of the calling worker of this pool, -1 from any other thread
+    int worker_index() const { return current_pool == this ? (int)current_worker : -1; }
+
+    template <typename F>
+    auto submit(F&& f) -> std::future<decltype(f())> {
+        using R = decltype(f());
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+        std::future<R> result = task->get_future();
+        push([task] { (*task)(); });
+        return result;
+    }
+
+    // Runs f(i) for i in [0, n) and blocks until all calls have returned,
+    // rethrowing the first exception. A worker that calls it runs queued
+    // tasks while it waits, so loops may nest inside pool tasks; when there
+    // is nothing to take it sleeps with the idle workers until new work is
+    // queued or its loop finishes.
+    template <typename F>
+    void parallel_for(size_t n, F&& f) {
+        if (n == 0) return;
+        size_t remaining = n;
+        bool finished = false;      // guarded by sleep_mutex, wakes a waiting worker
+        std::mutex done_mutex;
+        std::condition_variable done_cv;
+        std::exception_ptr error;
+
+        for (size_t i = 0; i < n; ++i) {
+            push([&, i] {
+                std::exception_ptr thrown;
+                try {
+                    f(i);
+                } catch (...) {
+                    thrown = std::current_exception();
+                }
+                std::lock_guard<std::mutex> lock(done_mutex);
+                if (thrown && !error) error = thrown;
+                if (--remaining == 0) {
+                    {
+                        std::lock_guard<std::mutex> sleep_lock(sleep_mutex);
+                        finished = true;
+                    }
+                    sleep_cv.notify_all();
+                    done_cv.notify_all();
+                }
+            });
+        }
+
+        std::unique_lock<std::mutex> lock(done_mutex);
+        if (current_pool == this) {
+            // Exit is decided under done_mutex, which the last task holds
+            // until it no longer touches this frame
+            std::function<void()> task;
+            while (remaining > 0) {
+                lock.unlock();
+                if (try_pop(current_worker, task)) {
+                    task();
+                    task = nullptr;
+                } else {
+                    std::unique_lock<std::mutex> sleep_lock(sleep_mutex);
+                    sleep_cv.wait(sleep_lock, [&] { return finished || queued.load() > 0; });
+                }
+                lock.lock();
+            }
+        } else {
+            done_cv.wait(lock, [&] { return remaining == 0; });
+        }
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+#endif /* __THREAD_POOL_HPP__ */
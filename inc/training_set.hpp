@@ -0,0 +1,57 @@
+#ifndef __TRAINING_SET_HPP__
+#define __TRAINING_SET_HPP__
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cassert>
+
+// Growable set of (x, y) observations. Inputs live in one row-major buffer so
+// X() is a contiguous n x d block that kernel code can use directly; both
+// buffers double their capacity when full, so push_back is amortized O(d).
+class TrainingSet {
+public:
+    using RowMatrixXd = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+private:
+    RowMatrixXd X_buf;      // capacity x d, first n rows in use
+    Eigen::VectorXd y_buf;  // capacity, first n entries in use
+    int n;
+
+    void grow(int min_capacity) {
+        int new_capacity = std::max(min_capacity, 2 * (int)X_buf.rows());
+        RowMatrixXd X_grown(new_capacity, X_buf.cols());
+        Eigen::VectorXd y_grown(new_capacity);
+        X_grown.topRows(n) = X_buf.topRows(n);
+        y_grown.head(n) = y_buf.head(n);
+        X_buf = std::move(X_grown);
+        y_buf = std::move(y_grown);
+    }
+
+public:
+    TrainingSet(int dim = 0, int capacity = 64) : X_buf(capacity, dim), y_buf(capacity), n{0} {}
+
+    void push_back(const Eigen::VectorXd& x, double y) {
+        assert(x.size() == X_buf.cols() && "Observation dimension mismatch");
+        if (n == X_buf.rows()) grow(n + 1);
+        X_buf.row(n) = x.transpose();
+        y_buf(n) = y;
+        ++n;
+    }
+
+    void reserve(int capacity) {
+        if (capacity > X_buf.rows()) grow(capacity);
+    }
+
+    void clear() { n = 0; }
+
+    int size() const { return n; }
+    int dim() const { return X_buf.cols(); }
+
+    RowMatrixXd::ConstRowsBlockXpr X() const { return X_buf.topRows(n); }
+    Eigen::VectorXd::ConstSegmentReturnType y() const { return y_buf.head(n); }
+
+    Eigen::VectorXd x(int i) const { return X_buf.row(i).transpose(); }
+    double y(int i) const { return y_buf(i); }
+};
+
+#endif /* __TRAINING_SET_HPP__ */
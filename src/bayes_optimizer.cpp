@@ -1,47 +1,290 @@
-#include <random>
 #include <iostream>
 #include <vector>
 #include <cmath>
 #include <string>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+#include <cassert>
+#include <stdexcept>
 #include <Eigen/Dense>
+#include <unsupported/Eigen/FFT>
 
 #include "bayes_optimizer.hpp"
+#include "normal_dist.hpp"
+#include "kernel_sum.hpp"
+#include "kde_kernels.hpp"
+#include "philox.hpp"
 
 double Omega::omega_ratio_kde(const VectorXd& returns, const VectorXd& kde_values) {
-    double threshold = 0.0;
-    double gain = kde_values(returns.array() > threshold).sum();
-    double loss = kde_values(returns.array() <= threshold).sum();
+    double zero = 0.0;
+    double gain = kde_values(returns.array() > zero).sum();
+    double loss = kde_values(returns.array() <= zero).sum();
     return gain / loss;
 }
 
+double Omega::empirical_omega(const VectorXd& returns, double tau) {
+    ArrayXd excess = returns.array() - tau;
+    double gain = excess.max(0.0).sum();
+    double loss = (-excess).max(0.0).sum();
+    return gain / loss;
+}
+
+VectorXd Omega::omega_curve(const VectorXd& returns, const VectorXd& thresholds) {
+    int T = returns.size();
+    vector<double> sorted(returns.data(), returns.data() + T);
+    sort(sorted.begin(), sorted.end());
+
+    // prefix[k] = sum of the k smallest returns
+    vector<double> prefix(T + 1, 0.0);
+    for (int k = 0; k < T; ++k) prefix[k + 1] = prefix[k] + sorted[k];
+
+    VectorXd omega(thresholds.size());
+    for (int i = 0; i < thresholds.size(); ++i) {
+        double tau = thresholds(i);
+        int k = upper_bound(sorted.begin(), sorted.end(), tau) - sorted.begin();
+        double loss = k * tau - prefix[k];
+        double gain = (prefix[T] - prefix[k]) - (T - k) * tau;
+        omega(i) = gain / loss;
+    }
+    return omega;
+}
+
+void Omega::set_incremental(bool enable, int _refresh_interval) {
+    lock_guard<mutex> lock(state_mutex);
+    incremental = enable;
+    refresh_interval = max(_refresh_interval, 1);
+    state_valid = false;
+}
+
+void Omega::invalidate() {
+    lock_guard<mutex> lock(state_mutex);
+    state_valid = false;
+}
+
+VectorXd Omega::portfolio_returns(const VectorXd& weights, const MatrixXd& asset_returns) {
+    if (!incremental) return asset_returns.transpose() * weights;
+
+    unique_lock<mutex> lock(state_mutex, try_to_lock);
+    if (!lock.owns_lock()) return asset_returns.transpose() * weights;
+
+    bool same_shape = state_valid && state_rows == asset_returns.rows() && state_cols == asset_returns.cols();
+    if (same_shape && updates_since_refresh < refresh_interval) {
+        VectorXd dw = weights - state_weights;
+        vector<Index> changed;
+        vector<double> changed_dw;
+        for (Index j = 0; j < dw.size(); ++j) {
+            if (dw(j) != 0.0) {
+                changed.push_back(j);
+                changed_dw.push_back(dw(j));
+            }
+        }
+
+        // Past half the assets the full GEMV is as cheap and exact
+        if (2 * changed.size() <= (size_t)dw.size()) {
+            // One pass down the column-major returns, reading the changed rows of each day
+            for (Index t = 0; t < asset_returns.cols(); ++t) {
+                const double *day = asset_returns.col(t).data();
+                double delta = 0.0;
+                for (size_t k = 0; k < changed.size(); ++k) delta += changed_dw[k] * day[changed[k]];
+                state_rp(t) += delta;
+            }
+            state_weights = weights;
+            ++updates_since_refresh;
+            return state_rp;
+        }
+    }
+
+    state_valid = true;
+    state_rows = asset_returns.rows();
+    state_cols = asset_returns.cols();
+    state_weights = weights;
+    state_rp = asset_returns.transpose() * weights;
+    updates_since_refresh = 0;
+    return state_rp;
+}
+
 // Objective function (for the GP)
 double Omega::operator()(const VectorXd& weights, const MatrixXd& asset_returns) {
-    VectorXd w = weights / weights.sum();
-    VectorXd rp = asset_returns.transpose() * w;
+    VectorXd rp = portfolio_returns(weights, asset_returns) / weights.sum();
+    if (empirical) return -empirical_omega(rp, threshold);
 
     double variance = (rp.array() - rp.mean()).square().sum() / (rp.size() - 1);  
     double standard_dev =  std::sqrt(variance);
 
     VectorXd kde_values = kernel_estimator.evaluate(rp, 1.06 * standard_dev * pow(rp.size(), -0.2), rp);
-    std::cout << "KDE: [" << kde_values.rows() << " x " << kde_values.cols() << "]" << std::endl;
     double omega = omega_ratio_kde(rp, kde_values);
 
     return -omega;
 }
 
+KDE::Kernel KDE::parse_kernel(const string& name)
+{
+    if (name == "gaussian") return Kernel::Gaussian;
+    if (name == "gaussian_binned") return Kernel::GaussianBinned;
+    if (name == "epanechnikov") return Kernel::Epanechnikov;
+    if (name == "triweight") return Kernel::Triweight;
+    if (name == "tricube") return Kernel::Tricube;
+    throw invalid_argument("Unknown KDE kernel type \"" + name + "\"");
+}
+
 VectorXd KDE::evaluate(const VectorXd& data, double bandwidth, const VectorXd& points)
 {
+    switch (kernel) {
+    case Kernel::GaussianBinned: return evaluate_binned(data, bandwidth, points);
+    case Kernel::Epanechnikov: return evaluate_window<KDEKernel::Epanechnikov>(data, bandwidth, points);
+    case Kernel::Triweight: return evaluate_window<KDEKernel::Triweight>(data, bandwidth, points);
+    case Kernel::Tricube: return evaluate_window<KDEKernel::Tricube>(data, bandwidth, points);
+    case Kernel::Gaussian: break;
+    }
+
     int n = data.size();
     int m = points.size();
     VectorXd kde_values(m);
 
+    // Raw exp(-u^2/2) sums on the widest SIMD path, normalized once at the end
+    KernelSum::gaussian(data.data(), n, points.data(), m, 1.0 / bandwidth, kde_values.data());
+    kde_values *= Normal::inv_sqrt_2pi / (n * bandwidth);
+
+    return kde_values;
+}
+
+VectorXd KDE::evaluate_binned(const VectorXd& data, double bandwidth, const VectorXd& points)
+{
+    int n = data.size();
+    int G = grid_size;
+
+    // Grid covering every sample and evaluation point, padded by the kernel support
+    double lo = min(data.minCoeff(), points.minCoeff()) - cutoff * bandwidth;
+    double hi = max(data.maxCoeff(), points.maxCoeff()) + cutoff * bandwidth;
+    double delta = (hi - lo) / (G - 1);
+
+    // Linear binning: each sample splits its unit mass between its two grid neighbours
+    VectorXd counts = VectorXd::Zero(G);
+    for (int i = 0; i < n; ++i) {
+        double pos = (data(i) - lo) / delta;
+        int k = min((int)pos, G - 2);
+        double frac = pos - k;
+        counts(k) += 1.0 - frac;
+        counts(k + 1) += frac;
+    }
+
+    // Kernel weights at grid offsets -L..L, zero padded so the circular
+    // convolution does not wrap onto the grid
+    int L = min(G - 1, (int)ceil(cutoff * bandwidth / delta));
+    int P = 1;
+    while (P < G + L) P <<= 1;
+
+    VectorXd padded_counts = VectorXd::Zero(P);
+    padded_counts.head(G) = counts;
+    VectorXd kernel_weights = VectorXd::Zero(P);
+    for (int l = -L; l <= L; ++l) {
+        kernel_weights((l + P) % P) = gaussian_kernel(l * delta / bandwidth) / (n * bandwidth);
+    }
+
+    FFT<double> fft;
+    VectorXcd counts_hat, kernel_hat;
+    fft.fwd(counts_hat, padded_counts);
+    fft.fwd(kernel_hat, kernel_weights);
+    VectorXcd density_hat = counts_hat.cwiseProduct(kernel_hat);
+    VectorXd density;
+    fft.inv(density, density_hat);
+
+    // Linear interpolation from the grid back to the evaluation points
+    int m = points.size();
+    VectorXd kde_values(m);
     for (int j = 0; j < m; ++j) {
+        double pos = (points(j) - lo) / delta;
+        int k = min((int)pos, G - 2);
+        double frac = pos - k;
+        kde_values(j) = max((1.0 - frac) * density(k) + frac * density(k + 1), 0.0);
+    }
+
+    return kde_values;
+}
+
+// Sliding-window evaluation for a kernel that is a polynomial in |u| on its
+// support. Samples within one radius left of the point (u <= 0) and right of
+// it (u > 0) are tracked by three monotone pointers, with their power sums
+// M_k = sum ((d - a) / r)^k kept around an anchor a. At a point x,
+// sum u^k = sum_j C(k, j) ((a - x) / r)^(k - j) M_j, which only amplifies
+// rounding by ~3^degree because the anchor is reset (and the sums rebuilt)
+// whenever x drifts a full radius away from it; those rebuilds cost O(n) in total.
+template <typename K>
+VectorXd KDE::evaluate_window(const VectorXd& data, double bandwidth, const VectorXd& points)
+{
+    constexpr int D = K::degree;
+    int n = data.size();
+    int m = points.size();
+    double radius = bandwidth / K::std_dev();
+
+    vector<double> d(data.data(), data.data() + n);
+    sort(d.begin(), d.end());
+    vector<int> order(m);
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), [&](int a, int b) { return points(a) < points(b); });
+
+    double binom[D + 1][D + 1] = {};
+    for (int k = 0; k <= D; ++k) {
+        binom[k][0] = 1.0;
+        for (int j = 1; j <= k; ++j) binom[k][j] = binom[k - 1][j - 1] + (j < k ? binom[k - 1][j] : 0.0);
+    }
+
+    double left[D + 1] = {}, right[D + 1] = {};
+    double anchor = 0.0;
+    bool anchored = false;
+    int lo = 0, mid = 0, hi = 0;    // left window [lo, mid), right window [mid, hi)
+
+    auto accumulate = [&](double *moments, double v, double sign) {
+        double p = sign;
+        for (int k = 0; k <= D; ++k) {
+            moments[k] += p;
+            p *= v;
+        }
+    };
+
+    VectorXd kde_values(m);
+    for (int idx : order) {
+        double x = points(idx);
+
+        if (!anchored || abs(x - anchor) > radius) {
+            anchor = x;
+            anchored = true;
+            fill(left, left + D + 1, 0.0);
+            fill(right, right + D + 1, 0.0);
+            lo = lower_bound(d.begin(), d.end(), x - radius) - d.begin();
+            mid = upper_bound(d.begin() + lo, d.end(), x) - d.begin();
+            hi = upper_bound(d.begin() + mid, d.end(), x + radius) - d.begin();
+            for (int i = lo; i < mid; ++i) accumulate(left, (d[i] - anchor) / radius, 1.0);
+            for (int i = mid; i < hi; ++i) accumulate(right, (d[i] - anchor) / radius, 1.0);
+        } else {
+            while (hi < n && d[hi] <= x + radius) accumulate(right, (d[hi++] - anchor) / radius, 1.0);
+            while (mid < hi && d[mid] <= x) {
+                double v = (d[mid++] - anchor) / radius;
+                accumulate(right, v, -1.0);
+                accumulate(left, v, 1.0);
+            }
+            while (lo < mid && d[lo] < x - radius) accumulate(left, (d[lo++] - anchor) / radius, -1.0);
+        }
+
+        // Shift the moments from the anchor to x: u = v + delta
+        double delta = (anchor - x) / radius;
+        double delta_pow[D + 1];
+        delta_pow[0] = 1.0;
+        for (int k = 1; k <= D; ++k) delta_pow[k] = delta_pow[k - 1] * delta;
+
         double sum = 0.0;
-        for (int i = 0; i < n; ++i) {
-            double u = (points(j) - data(i)) / bandwidth;
-            sum += gaussian_kernel(u);
+        for (int k = 0; k <= D; ++k) {
+            if (K::coeffs[k] == 0.0) continue;
+            double u_left = 0.0, u_right = 0.0;
+            for (int j = 0; j <= k; ++j) {
+                u_left += binom[k][j] * delta_pow[k - j] * left[j];
+                u_right += binom[k][j] * delta_pow[k - j] * right[j];
+            }
+            // |u|^k = (-u)^k on the left side
+            sum += K::coeffs[k] * ((k % 2 ? -u_left : u_left) + u_right);
         }
-        kde_values(j) = sum / (n * bandwidth);
+        kde_values(idx) = max(sum, 0.0) / (n * radius);
     }
 
     return kde_values;
@@ -49,116 +292,287 @@ VectorXd KDE::evaluate(const VectorXd& data, double bandwidth, const VectorXd& p
 
 double KDE::gaussian_kernel(double u)
 {
-    return exp(-0.5 * u * u) / sqrt(2.0 * M_PI);
+    return Normal::inv_sqrt_2pi * exp(-0.5 * u * u);
 }
 
-double BayesOptimizer::rbf_kernel(const VectorXd& x1, const VectorXd& x2, double length_scale)
+// Additive recurrence (R_d) low-discrepancy points in [0,1)^d, mapped onto the
+// simplex through normalized exponential spacings
+static MatrixXd simplex_candidates(int m, int d, long offset)
 {
-    return exp(-(x1 - x2).squaredNorm() / (2 * length_scale * length_scale));
+    // phi_d is the positive root of x^(d+1) = x + 1
+    double phi = 2.0;
+    for (int i = 0; i < 30; ++i) phi = pow(1.0 + phi, 1.0 / (d + 1));
+
+    VectorXd step(d);
+    for (int j = 0; j < d; ++j) step(j) = pow(1.0 / phi, j + 1);
+
+    MatrixXd candidates(m, d);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < d; ++j) {
+            double u = 0.5 + (offset + i) * step(j);
+            u -= floor(u);
+            candidates(i, j) = -log(max(u, 1e-12));
+        }
+        candidates.row(i) /= candidates.row(i).sum();
+    }
+    return candidates;
 }
 
-MatrixXd BayesOptimizer::compute_covariance(const MatrixXd& X, double length_scale) 
+// Euclidean projection onto { w : w >= 0, sum(w) = 1 }
+static VectorXd project_to_simplex(const VectorXd& v)
 {
-    int n = X.rows();
-    MatrixXd K(n, n);
-    for (int i = 0; i < n; ++i) {
-        for (int j = 0; j <= i; ++j) {
-            K(i, j) = rbf_kernel(X.row(i), X.row(j), length_scale);
-            K(j, i) = K(i, j);
-        }
+    VectorXd u = v;
+    sort(u.data(), u.data() + u.size(), greater<double>());
+
+    double cumsum = 0.0, theta = 0.0;
+    for (int i = 0; i < u.size(); ++i) {
+        cumsum += u(i);
+        double t = (cumsum - 1.0) / (i + 1);
+        if (u(i) - t > 0) theta = t;
     }
-    return K;
+    return (v.array() - theta).max(0.0);
 }
 
-double BayesOptimizer::ucb(const VectorXd& mu, const VectorXd& sigma, double beta) 
+// Standardized improvement z = (best - mu) / sigma, with sigma floored so
+// observed points do not divide by zero
+static ArrayXd improvement_z(const VectorXd& mu, const VectorXd& sigma, double best_value)
 {
-    return mu(0) + beta * sigma(0);
+    return (best_value - mu.array()) / sigma.array().max(1e-12);
+}
+
+VectorXd BayesOptimizer::ucb(const VectorXd& mu, const VectorXd& sigma, double beta) 
+{
+    return mu + beta * sigma;
 } 
 
-pair<VectorXd, VectorXd> BayesOptimizer::gp_predict(
-    const MatrixXd& X_train, 
-    const VectorXd& y_train,
-    const VectorXd& x_new, 
-    double noise,
-    double length_scale)
+VectorXd BayesOptimizer::expected_improvement(const VectorXd& mu, const VectorXd& sigma, double best_value)
+{
+    // sigma h(z), evaluated through log h(z) so it stays accurate in the left tail
+    return sigma.array().max(1e-12) * Normal::log_ei(improvement_z(mu, sigma, best_value)).exp();
+}
+
+VectorXd BayesOptimizer::log_expected_improvement(const VectorXd& mu, const VectorXd& sigma, double best_value)
+{
+    return sigma.array().max(1e-12).log() + Normal::log_ei(improvement_z(mu, sigma, best_value));
+}
+
+VectorXd BayesOptimizer::probability_of_improvement(const VectorXd& mu, const VectorXd& sigma, double best_value)
+{
+    return Normal::cdf(improvement_z(mu, sigma, best_value));
+}
+
+VectorXd BayesOptimizer::score(const VectorXd& mu, const VectorXd& sigma, double best_value)
+{
+    switch (acquisition) {
+    case Acquisition::EI:
+        return expected_improvement(mu, sigma, best_value);
+    case Acquisition::LogEI:
+        return log_expected_improvement(mu, sigma, best_value);
+    case Acquisition::PI:
+        return probability_of_improvement(mu, sigma, best_value);
+    case Acquisition::UCB:
+    default:
+        // The objective is minimized, so take the UCB of its negation
+        return ucb(-mu, sigma);
+    }
+}
+
+double BayesOptimizer::score_gradient(const Surrogate& gp, const VectorXd& x, double best_value, VectorXd& grad)
 {
-    MatrixXd K = compute_covariance(X_train, length_scale) + noise * MatrixXd::Identity(X_train.rows(), X_train.rows());
-    std::cout << "K: " << K.rows() << " y_train: " << y_train.size() << std::endl;
-    assert(K.rows() == y_train.size() && "Mismatch between K and y_train sizes");
-    VectorXd k_star(X_train.rows());
-    for (int i = 0; i < X_train.rows(); ++i) {
-        k_star(i) = rbf_kernel(X_train.row(i), x_new, length_scale);
+    GPPosterior post = gp.predict_gradient(x);
+
+    if (acquisition == Acquisition::UCB) {
+        const double beta = 2.0;
+        grad = -post.d_mu + beta * post.d_sigma;
+        return -post.mu + beta * post.sigma;
     }
 
-    LLT<MatrixXd> llt(K);
-    VectorXd alpha = llt.solve(y_train);
+    ArrayXd z(1);
+    z(0) = (best_value - post.mu) / post.sigma;
+    double cdf = Normal::cdf(z)(0), pdf = Normal::pdf(z)(0);
+
+    switch (acquisition) {
+    case Acquisition::PI:
+        // dz = (-dmu - z dsigma) / sigma
+        grad = pdf * (-post.d_mu - z(0) * post.d_sigma) / post.sigma;
+        return cdf;
+    case Acquisition::LogEI:
+        // d log EI = (-Phi dmu + phi dsigma) / (sigma h); divide through by phi
+        // in the left tail where both underflow
+        if (z(0) <= 0) {
+            double ratio = Normal::cdf_over_pdf(z)(0);
+            double h_over_pdf = Normal::ei_over_pdf(z)(0);
+            grad = (-ratio * post.d_mu + post.d_sigma) / (post.sigma * h_over_pdf);
+        } else {
+            grad = (-cdf * post.d_mu + pdf * post.d_sigma) / (post.sigma * (z(0) * cdf + pdf));
+        }
+        return log(post.sigma) + Normal::log_ei(z)(0);
+    case Acquisition::EI:
+    default:
+        grad = -cdf * post.d_mu + pdf * post.d_sigma;
+        return post.sigma * exp(Normal::log_ei(z)(0));
+    }
+}
 
-    double mu = k_star.dot(alpha);
-    double var = rbf_kernel(x_new, x_new, length_scale) - k_star.transpose() * llt.solve(k_star);
+VectorXd BayesOptimizer::refine(const Surrogate& gp, VectorXd x, double best_value)
+{
+    const int max_iters = 50;
+    const double min_step = 1e-6;
+
+    VectorXd grad;
+    double value = score_gradient(gp, x, best_value, grad);
+    double step = 0.05;
+
+    for (int iter = 0; iter < max_iters && step > min_step; ++iter) {
+        double grad_norm = grad.norm();
+        if (grad_norm < 1e-12) break;
+
+        VectorXd x_new = project_to_simplex(x + (step / grad_norm) * grad);
+        VectorXd grad_new;
+        double value_new = score_gradient(gp, x_new, best_value, grad_new);
+
+        if (value_new > value) {
+            x = std::move(x_new);
+            grad = std::move(grad_new);
+            value = value_new;
+            step *= 1.5;
+        } else {
+            step *= 0.5;
+        }
+    }
+    return x;
+}
 
-    return {VectorXd::Constant(1, mu), VectorXd::Constant(1, sqrt(var))};
+VectorXd BayesOptimizer::maximize_acquisition(const Surrogate& gp, const TrainingSet& observed,
+                                              double best_value, int iteration)
+{
+    int num_assets = observed.dim();
+
+    // Fresh stretch of the quasi-random sequence every iteration
+    MatrixXd candidates = simplex_candidates(num_candidates, num_assets, (long)iteration * num_candidates);
+
+    VectorXd mu, sigma;
+    tie(mu, sigma) = gp.predict_batch(candidates);
+    VectorXd scores = score(mu, sigma, best_value);
+
+    vector<int> order(num_candidates);
+    iota(order.begin(), order.end(), 0);
+    int starts = min(num_restarts, num_candidates);
+    partial_sort(order.begin(), order.begin() + starts, order.end(),
+                 [&](int a, int b) { return scores(a) > scores(b); });
+
+    // Refine the best candidates concurrently
+    vector<VectorXd> refined(starts);
+    vector<double> refined_scores(starts);
+    pool.parallel_for(starts, [&](size_t i) {
+        refined[i] = refine(gp, candidates.row(order[i]).transpose(), best_value);
+        VectorXd grad;
+        refined_scores[i] = score_gradient(gp, refined[i], best_value, grad);
+    });
+
+    auto is_new = [&](const VectorXd& x) {
+        return observed.size() == 0 ||
+               (observed.X().rowwise() - x.transpose()).rowwise().squaredNorm().minCoeff() >= 1e-12;
+    };
+
+    int best = -1;
+    for (int i = 0; i < starts; ++i) {
+        if (is_new(refined[i]) && (best < 0 || refined_scores[i] > refined_scores[best])) best = i;
+    }
+    if (best >= 0) return refined[best];
+
+    // Every refinement collapsed onto an observed point; fall back to an unrefined candidate
+    return candidates.row(order[0]).transpose();
 }
 
 VectorXd BayesOptimizer::optimize(const MatrixXd& asset_returns, int n_calls) {
 
     int num_assets = asset_returns.rows(); 
+    objective->invalidate();
 
-    vector<VectorXd> X_train;
-    VectorXd y_train(num_assets);
-
-    // Initialize with random points
-    random_device rd;
-    mt19937 gen(rd());
-    uniform_real_distribution<> dis(0.0, 1.0);
+    TrainingSet train(num_assets, max(n_calls, num_assets));
 
+    // Initialize with random points on the simplex: normalized exponentials are uniform on it
+    vector<VectorXd> init_points(num_assets);
     for (int i = 0; i < num_assets; ++i) {
+        Philox::Stream rng(seed, i);
         VectorXd weights(num_assets);
         for (int j = 0; j < num_assets; ++j) {
-            weights(j) = dis(gen);
+            weights(j) = rng.exponential();
         }
-        X_train.push_back(weights);
-        y_train(i) = (*objective)(weights, asset_returns);
+        init_points[i] = weights / weights.sum();
     }
-
-    VectorXd best_weights = X_train[0];
-    double best_value = y_train(0);
-
-    std::cout << "X_train:" << std::endl;
-    for (const auto& vec : X_train) {
-        std::cout << "[" << vec << "]" << std::endl;
+    vector<double> init_values(num_assets);
+    pool.parallel_for(num_assets, [&](size_t i) {
+        init_values[i] = (*objective)(init_points[i], asset_returns);
+    });
+    for (int i = 0; i < num_assets; ++i) {
+        train.push_back(init_points[i], init_values[i]);
     }
 
-    std::cout << "y_train: " << "[" << y_train.transpose() << "]" << std::endl;
+    Index best_idx;
+    double best_value = train.y().minCoeff(&best_idx);
+    VectorXd best_weights = train.x(best_idx);
 
-    for (int call = num_assets; call < n_calls; ++call) {
-        // GP Prediction and UCB Acquisition
-        VectorXd mu, sigma;
-        double max_ucb = -INFINITY;
-        VectorXd next_point = VectorXd::Zero(num_assets);
+    std::cout << "X_train:" << std::endl;
+    std::cout << train.X() << std::endl;
+    std::cout << "y_train: " << "[" << train.y().transpose() << "]" << std::endl;
+
+    // Factorize once; each new observation extends the Cholesky factor in O(n^2)
+    unique_ptr<Surrogate> gp = make_unique<GaussianProcess>();
+    gp->fit(train);
+    bool sparse = false;
+
+    int last_refit = num_assets - refit_interval;
+    for (int call = num_assets; call < n_calls; ) {
+        // The exact GP is O(n^3) to refit and O(n^2) per update; past the
+        // threshold move to FITC at O(n m^2), whether or not refits are enabled
+        if (!sparse && train.size() >= sparse_threshold) {
+            gp = make_unique<SparseGaussianProcess>(gp->hyperparameters(), num_inducing);
+            gp->fit(train);
+            sparse = true;
+        }
 
-        for (const auto& x : X_train) {
-            tie(mu, sigma) = gp_predict(Map<MatrixXd>(X_train[0].data(), X_train.size(), num_assets), y_train, x);
-            double current_ucb = ucb(mu, sigma);
+        // Marginal likelihood refits are O(n^3) per step, so only run every refit_interval calls
+        if (refit_interval > 0 && call - last_refit >= refit_interval) {
+            gp->fit_hyperparameters(pool);
+            last_refit = call;
+        }
 
-            if (current_ucb > max_ucb) {
-                max_ucb = current_ucb;
-                next_point = x;
+        // Kriging believer: condition a copy of the GP on its own mean at each
+        // proposal so the q points of a batch spread out
+        int q = min(batch_size, n_calls - call);
+        vector<VectorXd> batch;
+        TrainingSet seen = train;
+        unique_ptr<Surrogate> gp_believer = (q > 1) ? gp->clone() : nullptr;
+        for (int k = 0; k < q; ++k) {
+            const Surrogate& gp_k = (k == 0) ? *gp : *gp_believer;
+            VectorXd x = maximize_acquisition(gp_k, seen, best_value, call + k);
+            if (k + 1 < q) {
+                gp_believer->add_observation(x, gp_believer->predict(x).first);
             }
+            seen.push_back(x, 0.0);
+            batch.push_back(std::move(x));
         }
 
-        // Evaluate the objective at the new point
-        double new_value = (*objective)(next_point, asset_returns);
-
-        // Update the training set
-        X_train.push_back(next_point);
-        y_train.conservativeResize(call + 1);
-        y_train(call) = new_value;
-
-        // Check for improvement
-        if (new_value < best_value) {
-            best_value = new_value;
-            best_weights = next_point;
+        // Evaluate the batch concurrently
+        vector<double> values(q);
+        pool.parallel_for(q, [&](size_t k) {
+            values[k] = (*objective)(batch[k], asset_returns);
+        });
+
+        // Update the training set with the observed values
+        for (int k = 0; k < q; ++k) {
+            train.push_back(batch[k], values[k]);
+            gp->add_observation(batch[k], values[k]);
+
+            // Check for improvement
+            if (values[k] < best_value) {
+                best_value = values[k];
+                best_weights = batch[k];
+            }
         }
+        call += q;
     }
 
     return best_weights / best_weights.sum();  // Normalize the weights
@@ -0,0 +1,80 @@
+#include <cmath>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <Eigen/Dense>
+
+#include "bootstrap.hpp"
+#include "philox.hpp"
+
+using namespace std;
+using namespace Eigen;
+
+BootstrapEngine::BootstrapEngine(const MatrixXd& asset_returns, double _mean_block_length,
+                                 BlockScheme _scheme, int _batch_size, size_t num_threads)
+    : T(asset_returns.cols()), mean_block_length{max(_mean_block_length, 1.0)}, scheme{_scheme},
+      batch_size{max(_batch_size, 1)}, pool(num_threads)
+{
+    int N = asset_returns.rows();
+    assert(T > 0 && "Bootstrap needs at least one day of returns");
+
+    // Day-major log growth, accumulated over two copies of the sample so
+    // that wrapped blocks need no special case
+    log_growth.resize(2 * T + 1, N);
+    log_growth.row(0).setZero();
+    for (int k = 0; k < 2 * T; ++k) {
+        log_growth.row(k + 1) = log_growth.row(k) + asset_returns.col(k % T).array().log1p().matrix().transpose();
+    }
+}
+
+WealthStats BootstrapEngine::simulate(const VectorXd& weights, int64_t num_paths, int num_steps, uint64_t seed)
+{
+    int N = log_growth.cols();
+    assert(weights.size() == N && "Weight dimension mismatch");
+
+    int64_t num_batches = (num_paths + batch_size - 1) / batch_size;
+    int64_t num_tasks = min<int64_t>(num_batches, MonteCarloEngine::summary_chunks);
+    vector<TDigest> sketches(num_tasks);
+
+    int fixed_length = max(1, (int)lround(mean_block_length));
+    double log_continue = log1p(-1.0 / mean_block_length);   // log(1 - p), -inf when p = 1
+    RowVectorXd cycle = log_growth.row(T);                    // growth over one full pass of the sample
+
+    pool.parallel_for(num_tasks, [&](size_t task) {
+        int64_t first = num_batches * task / num_tasks;
+        int64_t last = num_batches * (task + 1) / num_tasks;
+
+        RowVectorXd path_growth(N);
+        vector<double> wealth(batch_size);
+        for (int64_t batch = first; batch < last; ++batch) {
+            Philox::Stream rng(seed, batch);
+
+            int64_t begin = batch * batch_size;
+            int64_t end = min<int64_t>(begin + batch_size, num_paths);
+            for (int64_t path = begin; path < end; ++path) {
+                path_growth.setZero();
+                for (int t = 0; t < num_steps; ) {
+                    int length = fixed_length;
+                    if (scheme == BlockScheme::Stationary) {
+                        // Geometric(p) on {1, 2, ...} by inversion, u in (0, 1)
+                        length = 1 + (int)min(floor(log(rng.uniform()) / log_continue), (double)num_steps);
+                    }
+                    length = min(length, num_steps - t);
+
+                    int s = (int)rng.below(T);
+                    int remaining = length;
+                    for (; remaining > T; remaining -= T) path_growth += cycle;
+                    path_growth += log_growth.row(s + remaining) - log_growth.row(s);
+                    t += length;
+                }
+                wealth[path - begin] = path_growth.array().exp().matrix().dot(weights.transpose());
+            }
+            sketches[task].add(wealth.data(), end - begin);
+        }
+        sketches[task].compress();
+    });
+
+    TDigest digest;
+    for (const TDigest& sketch : sketches) digest.merge(sketch);
+    return MonteCarloEngine::summarize(digest);
+}
@@ -0,0 +1,493 @@
+#include <cmath>
+#include <cassert>
+#include <algorithm>
+#include <vector>
+#include <numeric>
+#include <Eigen/Dense>
+
+#include "gaussian_process.hpp"
+#include "philox.hpp"
+
+using namespace std;
+using namespace Eigen;
+
+// Squared distances between the rows of A and B after scaling each column by
+// inv_ls. ||a - b||^2 = ||a||^2 + ||b||^2 - 2 a.b, with the inner products as one GEMM.
+template <typename DerivedA, typename DerivedB>
+static MatrixXd scaled_sq_dist(const MatrixBase<DerivedA>& A, const MatrixBase<DerivedB>& B, const VectorXd& inv_ls)
+{
+    MatrixXd A_s = A * inv_ls.asDiagonal();
+    MatrixXd B_s = B * inv_ls.asDiagonal();
+    MatrixXd sq_dist = -2.0 * A_s * B_s.transpose();
+    sq_dist.colwise() += A_s.rowwise().squaredNorm();
+    sq_dist.rowwise() += B_s.rowwise().squaredNorm().transpose();
+    return sq_dist.cwiseMax(0.0);
+}
+
+// ARD RBF kernel matrix between the rows of A and B
+template <typename DerivedA, typename DerivedB>
+static MatrixXd ard_kernel(const MatrixBase<DerivedA>& A, const MatrixBase<DerivedB>& B, const VectorXd& inv_ls, double sf2)
+{
+    return sf2 * (-0.5 * scaled_sq_dist(A, B, inv_ls)).array().exp();
+}
+
+// sum_i c_i dk(x, x_i)/dx given k_i = k(x, x_i). For the ARD RBF kernel
+// dk_i/dx = -k_i (x - x_i) ./ l^2, so the sum is (X^T (c.k) - (1^T (c.k)) x) ./ l^2
+template <typename Derived>
+static VectorXd kernel_gradient(const MatrixBase<Derived>& X, const VectorXd& x, const VectorXd& k,
+                                const VectorXd& c, const VectorXd& inv_ls)
+{
+    VectorXd ck = c.cwiseProduct(k);
+    return inv_ls.cwiseAbs2().cwiseProduct(X.transpose() * ck - ck.sum() * x);
+}
+
+// Log marginal likelihood of centered targets y under theta = [log l_1..d, log sf2, log noise]
+// and, if grad is given, its gradient 0.5 tr((alpha alpha^T - K_y^-1) dK_y/dtheta).
+static double log_marginal_likelihood(const MatrixXd& X, const VectorXd& y, const VectorXd& theta, VectorXd* grad)
+{
+    int n = X.rows(), d = X.cols();
+    VectorXd inv_ls = (-theta.head(d)).array().exp();
+    double sf2 = exp(theta(d));
+    double noise = exp(theta(d + 1));
+
+    MatrixXd K_f = ard_kernel(X, X, inv_ls, sf2);
+    MatrixXd K_y = K_f;
+    K_y.diagonal().array() += noise;
+
+    LLT<MatrixXd> llt(K_y);
+    if (llt.info() != Success) return -INFINITY;
+
+    VectorXd alpha = llt.solve(y);
+    double lml = -0.5 * y.dot(alpha)
+                 - llt.matrixLLT().diagonal().array().log().sum()
+                 - 0.5 * n * log(2.0 * M_PI);
+
+    if (grad) {
+        // The inverse reuses the factor: K_y^-1 = L^-T L^-1
+        MatrixXd W = alpha * alpha.transpose() - llt.solve(MatrixXd::Identity(n, n));
+        MatrixXd WK = W.cwiseProduct(K_f);
+
+        grad->resize(d + 2);
+        for (int k = 0; k < d; ++k) {
+            // dK/dlog(l_k) = K_f .* (x_ik - x_jk)^2 / l_k^2
+            ArrayXd col = X.col(k).array() * inv_ls(k);
+            double g = 0.0;
+            for (int j = 0; j < n; ++j) {
+                g += (WK.col(j).array() * (col - col(j)).square()).sum();
+            }
+            (*grad)(k) = 0.5 * g;
+        }
+        (*grad)(d) = 0.5 * WK.sum();
+        (*grad)(d + 1) = 0.5 * noise * W.trace();
+    }
+    return lml;
+}
+
+// Gradient ascent with step adaptation on the log hyperparameters, clamped to [lower, upper]
+static double maximize_lml(const MatrixXd& X, const VectorXd& y, VectorXd& theta,
+                           const VectorXd& lower, const VectorXd& upper, int max_iters)
+{
+    VectorXd grad;
+    double value = log_marginal_likelihood(X, y, theta, &grad);
+    if (!isfinite(value)) return value;
+
+    double step = 0.1;
+    for (int iter = 0; iter < max_iters && step > 1e-6; ++iter) {
+        double grad_norm = grad.norm();
+        if (grad_norm < 1e-8) break;
+
+        VectorXd theta_new = (theta + (step / grad_norm) * grad).cwiseMax(lower).cwiseMin(upper);
+        VectorXd grad_new;
+        double value_new = log_marginal_likelihood(X, y, theta_new, &grad_new);
+
+        if (value_new > value) {
+            theta = std::move(theta_new);
+            grad = std::move(grad_new);
+            value = value_new;
+            step *= 1.5;
+        } else {
+            step *= 0.5;
+        }
+    }
+    return value;
+}
+
+double GaussianProcess::kernel(const Ref<const VectorXd>& x1, const Ref<const VectorXd>& x2) const
+{
+    return hyper.signal_variance * exp(-0.5 * (x1 - x2).cwiseProduct(inv_length_scales).squaredNorm());
+}
+
+void GaussianProcess::reserve(int capacity)
+{
+    if (capacity <= L.rows()) return;
+
+    // Grow geometrically so repeated add_observation calls copy O(n^2) amortized
+    int new_capacity = max(capacity, 2 * (int)L.rows());
+    MatrixXd L_grown(new_capacity, new_capacity);
+    L_grown.topLeftCorner(n, n) = L.topLeftCorner(n, n);
+    L = std::move(L_grown);
+}
+
+void GaussianProcess::update_alpha()
+{
+    auto L_n = L.topLeftCorner(n, n).triangularView<Lower>();
+    alpha = L_n.solve((data.y().array() - y_mean).matrix());
+    L_n.transpose().solveInPlace(alpha);
+}
+
+void GaussianProcess::factorize()
+{
+    auto X = data.X();
+    int d = data.dim();
+    if (hyper.length_scales.size() != d) {
+        hyper.length_scales = VectorXd::Constant(d, hyper.length_scales(0));
+    }
+    inv_length_scales = hyper.length_scales.cwiseInverse();
+
+    MatrixXd K_noisy = ard_kernel(X, X, inv_length_scales, hyper.signal_variance);
+    K_noisy.diagonal().array() += hyper.noise;
+    LLT<MatrixXd> llt(K_noisy);
+    L.topLeftCorner(n, n) = llt.matrixL();
+
+    update_alpha();
+}
+
+void GaussianProcess::set_hyperparameters(const GPHyperparameters& _hyper)
+{
+    hyper = _hyper;
+    if (n > 0) factorize();
+}
+
+void GaussianProcess::fit(const TrainingSet& train)
+{
+    n = 0;
+    reserve(train.size());
+    data = train;
+    n = data.size();
+    y_mean = data.y().mean();
+
+    factorize();
+}
+
+void GaussianProcess::add_observation(const VectorXd& x_new, double y_new)
+{
+    assert(n > 0 && x_new.size() == data.dim() && "fit() must precede add_observation()");
+
+    reserve(n + 1);
+
+    auto X = data.X();
+    VectorXd k_new(n);
+    for (int i = 0; i < n; ++i) {
+        k_new(i) = kernel(X.row(i).transpose(), x_new);
+    }
+    double k_self = hyper.signal_variance;
+
+    // [L 0; l^T d] with L l = k_new and d^2 = k(x,x) + noise - l^T l
+    VectorXd l = L.topLeftCorner(n, n).triangularView<Lower>().solve(k_new);
+    double d2 = k_self + hyper.noise - l.squaredNorm();
+    double d = sqrt(max(d2, hyper.noise));
+
+    L.block(n, 0, 1, n) = l.transpose();
+    L.block(0, n, n, 1).setZero();
+    L(n, n) = d;
+
+    data.push_back(x_new, y_new);
+    ++n;
+
+    update_alpha();
+}
+
+pair<double, double> GaussianProcess::predict(const VectorXd& x_new) const
+{
+    auto X = data.X();
+    VectorXd k_star(n);
+    for (int i = 0; i < n; ++i) {
+        k_star(i) = kernel(X.row(i).transpose(), x_new);
+    }
+
+    double mu = y_mean + k_star.dot(alpha);
+    VectorXd v = L.topLeftCorner(n, n).triangularView<Lower>().solve(k_star);
+    double var = hyper.signal_variance - v.squaredNorm();
+
+    return {mu, sqrt(max(var, 0.0))};
+}
+
+MatrixXd GaussianProcess::cross_kernel(const MatrixXd& X_new) const
+{
+    return ard_kernel(X_new, data.X(), inv_length_scales, hyper.signal_variance);
+}
+
+pair<VectorXd, VectorXd> GaussianProcess::predict_batch(const MatrixXd& X_new) const
+{
+    // Bound the n x block solve workspace for very large candidate sets
+    const int block_size = 4096;
+    int m = X_new.rows();
+    VectorXd mu(m), sigma(m);
+
+    auto L_n = L.topLeftCorner(n, n).triangularView<Lower>();
+    for (int start = 0; start < m; start += block_size) {
+        int rows = min(block_size, m - start);
+        MatrixXd K_star = cross_kernel(X_new.middleRows(start, rows));
+
+        mu.segment(start, rows) = (K_star * alpha).array() + y_mean;
+
+        MatrixXd V = K_star.transpose();
+        L_n.solveInPlace(V);
+        sigma.segment(start, rows) = (hyper.signal_variance - V.colwise().squaredNorm().transpose().array()).max(0.0).sqrt();
+    }
+
+    return {mu, sigma};
+}
+
+GPPosterior GaussianProcess::predict_gradient(const VectorXd& x_new) const
+{
+    auto X_n = data.X();
+    VectorXd k_star(n);
+    for (int i = 0; i < n; ++i) {
+        k_star(i) = kernel(X_n.row(i).transpose(), x_new);
+    }
+
+    auto L_n = L.topLeftCorner(n, n).triangularView<Lower>();
+    VectorXd v = L_n.solve(k_star);
+    VectorXd beta = L.topLeftCorner(n, n).transpose().triangularView<Upper>().solve(v);   // (K + noise I)^-1 k_star
+
+    GPPosterior post;
+    post.mu = y_mean + k_star.dot(alpha);
+    post.sigma = sqrt(max(hyper.signal_variance - v.squaredNorm(), 1e-12));
+
+    post.d_mu = kernel_gradient(X_n, x_new, k_star, alpha, inv_length_scales);
+
+    // d(sigma^2)/dx = -2 (dk/dx)^T beta
+    VectorXd d_var = -2.0 * kernel_gradient(X_n, x_new, k_star, beta, inv_length_scales);
+    post.d_sigma = d_var / (2.0 * post.sigma);
+
+    return post;
+}
+
+void GaussianProcess::fit_hyperparameters(ThreadPool& pool, int num_restarts, int max_iters)
+{
+    if (n < 2) return;
+
+    int d = data.dim();
+    MatrixXd X_n = data.X();
+    VectorXd y_c = data.y().array() - y_mean;
+    double y_var = max(y_c.squaredNorm() / n, 1e-12);
+
+    // Bounds in log space, with signal variance and noise relative to the target variance
+    VectorXd lower(d + 2), upper(d + 2);
+    lower.head(d).setConstant(log(1e-3));
+    upper.head(d).setConstant(log(1e2));
+    lower(d) = log(y_var * 1e-3);
+    upper(d) = log(y_var * 1e3);
+    lower(d + 1) = log(1e-10);
+    upper(d + 1) = log(y_var);
+
+    VectorXd current(d + 2);
+    current.head(d) = hyper.length_scales.array().log();
+    current(d) = log(hyper.signal_variance);
+    current(d + 1) = log(hyper.noise);
+    current = current.cwiseMax(lower).cwiseMin(upper);
+
+    num_restarts = max(num_restarts, 1);
+    vector<VectorXd> thetas(num_restarts);
+    vector<double> values(num_restarts);
+
+    pool.parallel_for(num_restarts, [&](size_t r) {
+        VectorXd theta = current;
+        if (r > 0) {
+            // Restart r of a fit on n points always starts from stream r under key n
+            Philox::Stream rng(n, r);
+            for (int k = 0; k < d; ++k) theta(k) = log(0.05) + rng.uniform() * (log(2.0) - log(0.05));
+            theta(d) = log(y_var) + 2.0 * rng.uniform() - 1.0;
+            theta(d + 1) = log(y_var) + log(1e-6) + rng.uniform() * (log(1e-2) - log(1e-6));
+            theta = theta.cwiseMax(lower).cwiseMin(upper);
+        }
+        values[r] = maximize_lml(X_n, y_c, theta, lower, upper, max_iters);
+        thetas[r] = theta;
+    });
+
+    int best = max_element(values.begin(), values.end()) - values.begin();
+    if (!isfinite(values[best])) return;
+
+    hyper.length_scales = thetas[best].head(d).array().exp();
+    hyper.signal_variance = exp(thetas[best](d));
+    hyper.noise = exp(thetas[best](d + 1));
+
+    factorize();
+}
+
+void SparseGaussianProcess::set_hyperparameters(const GPHyperparameters& _hyper)
+{
+    hyper = _hyper;
+    if (data.size() > 0) {
+        TrainingSet train = data;
+        fit(train);
+    }
+}
+
+void SparseGaussianProcess::select_inducing()
+{
+    int n = data.size();
+    int m = min(num_inducing, n);
+    inducing = TrainingSet(data.dim(), max(m, 1));
+
+    // Keep the best quarter of the observations, where the acquisition
+    // concentrates, and spread the rest evenly over the remaining history
+    vector<int> order(n);
+    iota(order.begin(), order.end(), 0);
+    int n_best = (m < n) ? m / 4 : m;
+    partial_sort(order.begin(), order.begin() + n_best, order.end(),
+                 [&](int i, int j) { return data.y(i) < data.y(j); });
+
+    vector<bool> chosen(n, false);
+    for (int i = 0; i < n_best; ++i) chosen[order[i]] = true;
+
+    vector<int> rest;
+    for (int i = 0; i < n; ++i) {
+        if (!chosen[i]) rest.push_back(i);
+    }
+    int n_rest = m - n_best;
+    for (int k = 0; k < n_rest; ++k) {
+        chosen[rest[(long)k * rest.size() / n_rest]] = true;
+    }
+
+    for (int i = 0; i < n; ++i) {
+        if (chosen[i]) inducing.push_back(data.x(i), data.y(i));
+    }
+}
+
+MatrixXd SparseGaussianProcess::cross_kernel(const MatrixXd& X_new) const
+{
+    return ard_kernel(X_new, inducing.X(), inv_length_scales, hyper.signal_variance);
+}
+
+void SparseGaussianProcess::update_weights()
+{
+    a = llt_B.solve(b);
+    L_uu.transpose().triangularView<Upper>().solveInPlace(a);
+}
+
+void SparseGaussianProcess::fit(const TrainingSet& train)
+{
+    data = train;
+    int n = data.size();
+    int d = data.dim();
+    y_mean = data.y().mean();
+
+    if (hyper.length_scales.size() != d) {
+        hyper.length_scales = VectorXd::Constant(d, hyper.length_scales(0));
+    }
+    inv_length_scales = hyper.length_scales.cwiseInverse();
+
+    select_inducing();
+    int m = inducing.size();
+
+    MatrixXd K_uu = ard_kernel(inducing.X(), inducing.X(), inv_length_scales, hyper.signal_variance);
+    K_uu.diagonal().array() += 1e-8 * hyper.signal_variance;
+    L_uu = LLT<MatrixXd>(K_uu).matrixL();
+
+    // Accumulate V Lambda^-1 V^T and V Lambda^-1 y over row blocks so no
+    // m x n matrix is ever held
+    const int block_size = 1024;
+    MatrixXd B = MatrixXd::Identity(m, m);
+    b = VectorXd::Zero(m);
+    for (int start = 0; start < n; start += block_size) {
+        int rows = min(block_size, n - start);
+        auto X_blk = data.X().middleRows(start, rows);
+
+        MatrixXd V = ard_kernel(inducing.X(), X_blk, inv_length_scales, hyper.signal_variance);
+        L_uu.triangularView<Lower>().solveInPlace(V);
+
+        // FITC diagonal correction: Lambda = diag(K_ff - Q_ff) + noise
+        ArrayXd lambda = (hyper.signal_variance - V.colwise().squaredNorm().transpose().array()
+                          + hyper.noise).max(hyper.noise);
+        MatrixXd V_scaled = V * lambda.inverse().matrix().asDiagonal();
+
+        B.noalias() += V_scaled * V.transpose();
+        b.noalias() += V_scaled * (data.y().segment(start, rows).array() - y_mean).matrix();
+    }
+    llt_B.compute(B);
+
+    update_weights();
+}
+
+void SparseGaussianProcess::add_observation(const VectorXd& x_new, double y_new)
+{
+    assert(inducing.size() > 0 && "fit() must precede add_observation()");
+
+    data.push_back(x_new, y_new);
+
+    VectorXd v = ard_kernel(inducing.X(), x_new.transpose(), inv_length_scales, hyper.signal_variance);
+    L_uu.triangularView<Lower>().solveInPlace(v);
+    double lambda = max(hyper.signal_variance - v.squaredNorm() + hyper.noise, hyper.noise);
+
+    llt_B.rankUpdate(v, 1.0 / lambda);
+    b += v * ((y_new - y_mean) / lambda);
+
+    update_weights();
+}
+
+pair<double, double> SparseGaussianProcess::predict(const VectorXd& x_new) const
+{
+    auto [mu, sigma] = predict_batch(x_new.transpose());
+    return {mu(0), sigma(0)};
+}
+
+pair<VectorXd, VectorXd> SparseGaussianProcess::predict_batch(const MatrixXd& X_new) const
+{
+    const int block_size = 4096;
+    int rows_total = X_new.rows();
+    VectorXd mu(rows_total), sigma(rows_total);
+
+    for (int start = 0; start < rows_total; start += block_size) {
+        int rows = min(block_size, rows_total - start);
+        MatrixXd K_star = cross_kernel(X_new.middleRows(start, rows));
+
+        mu.segment(start, rows) = (K_star * a).array() + y_mean;
+
+        // var = k(x,x) - k_u^T K_uu^-1 k_u + k_u^T L_uu^-T B^-1 L_uu^-1 k_u
+        MatrixXd W = K_star.transpose();
+        L_uu.triangularView<Lower>().solveInPlace(W);
+        MatrixXd U = llt_B.matrixL().solve(W);
+        ArrayXd var = hyper.signal_variance - W.colwise().squaredNorm().transpose().array()
+                      + U.colwise().squaredNorm().transpose().array();
+        sigma.segment(start, rows) = var.max(0.0).sqrt();
+    }
+
+    return {mu, sigma};
+}
+
+GPPosterior SparseGaussianProcess::predict_gradient(const VectorXd& x_new) const
+{
+    auto Z = inducing.X();
+    VectorXd k_u = ard_kernel(Z, x_new.transpose(), inv_length_scales, hyper.signal_variance);
+
+    VectorXd w = L_uu.triangularView<Lower>().solve(k_u);
+    VectorXd u = llt_B.matrixL().solve(w);
+
+    GPPosterior post;
+    post.mu = y_mean + k_u.dot(a);
+    post.sigma = sqrt(max(hyper.signal_variance - w.squaredNorm() + u.squaredNorm(), 1e-12));
+
+    // var(x) = k(x,x) - k_u^T M k_u with M = K_uu^-1 - L_uu^-T B^-1 L_uu^-1
+    VectorXd beta = w - llt_B.matrixU().solve(u);
+    L_uu.transpose().triangularView<Upper>().solveInPlace(beta);
+
+    post.d_mu = kernel_gradient(Z, x_new, k_u, a, inv_length_scales);
+    VectorXd d_var = -2.0 * kernel_gradient(Z, x_new, k_u, beta, inv_length_scales);
+    post.d_sigma = d_var / (2.0 * post.sigma);
+
+    return post;
+}
+
+void SparseGaussianProcess::fit_hyperparameters(ThreadPool& pool, int num_restarts, int max_iters)
+{
+    if (inducing.size() < 2) return;
+
+    GaussianProcess subset;
+    subset.set_hyperparameters(hyper);
+    subset.fit(inducing);
+    subset.fit_hyperparameters(pool, num_restarts, max_iters);
+
+    set_hyperparameters(subset.hyperparameters());
+}
@@ -1,4 +1,3 @@
-#include <ctime>
 #include <cstdlib>
 #include <cstdio>
 #include <algorithm>
@@ -11,6 +10,7 @@
 #include "simdjson.h"
 #include "libcurl.hpp"
 #include "bayes_optimizer.hpp"
+#include "philox.hpp"
 
 #define TRADING_DAYS 365
 
@@ -196,7 +196,7 @@ std::ostream& operator<<(std::ostream &os, const Portfolio &port) {
     return os;
 }
 
-Portfolio::Portfolio(std::vector<Market_Data> _assets) : assets{_assets} {
+Portfolio::Portfolio(std::vector<Market_Data> _assets, uint64_t seed) : assets{_assets} {
     size_t num_assets = assets.size();
     size_t data_len = assets.at(0).returns.size();
     for(auto asset : assets) {
@@ -224,18 +224,22 @@ Portfolio::Portfolio(std::vector<Market_Data> _assets) : assets{_assets} {
 
     mean = std::move(mu.transpose());
 
-    std::srand(std::time(0)); 
-    Eigen::RowVectorXd init_weights = Eigen::RowVectorXd::Random(num_assets).cwiseAbs();
+    Philox::Stream rng(seed, 0);
+    Eigen::RowVectorXd init_weights(num_assets);
+    rng.uniforms(init_weights.data(), num_assets);
     init_weights /= init_weights.sum();
     weights = std::move(init_weights);
 }
 
-bool Portfolio::optimize_sharpe(uint32_t num_epochs) { 
-    double sharpe;
+// Gradient ascent of the daily Sharpe ratio (w . mean) / sqrt(w' cov w) by
+// reverse-mode AutoDiff, renormalizing the weights to sum to one after each
+// step. Returns the ratio at the last evaluated weights.
+static double sharpe_ascent(const Eigen::RowVectorXd& mean, const Eigen::MatrixXd& covariance,
+                            Eigen::RowVectorXd& weights, uint32_t num_epochs) {
+    double sharpe = 0.0;
     const double learning_rate = 0.01;
     const double tolerance = 1e-9;
 
-    std::cout << "Sharpe Ratio Optimization" << std::endl;
     for(int i=0; i<num_epochs; i++) {
 
         // Reinitialize the computation graph 
@@ -258,14 +262,84 @@ bool Portfolio::optimize_sharpe(uint32_t num_epochs) {
         weights.array() += (learning_rate * w1.partial.array());
         weights.array() /= weights.array().sum();
     }
+    return sharpe;
+}
+
+bool Portfolio::optimize_sharpe(uint32_t num_epochs) { 
+    std::cout << "Sharpe Ratio Optimization" << std::endl;
+    double sharpe = sharpe_ascent(mean, covariance, weights, num_epochs);
 
     sharpe_ratio = sharpe * std::sqrt(TRADING_DAYS);
 
     return true; 
 }
 
+bool Portfolio::optimize_sharpe_resampled(int num_resamples, uint32_t num_epochs, uint64_t seed) {
+    int N = mean.cols();
+    int T = returns.cols();
+    std::cout << "Resampled Sharpe Ratio Optimization (" << num_resamples << " histories)" << std::endl;
+
+    Eigen::LLT<Eigen::MatrixXd> llt(covariance);
+    if (num_resamples < 1 || T < 2 || llt.info() != Eigen::Success) {
+        std::cerr << "Resampling needs a positive definite covariance and at least two days" << std::endl;
+        return false;
+    }
+    Eigen::MatrixXd factor = llt.matrixL();
+    const Eigen::RowVectorXd start = weights;
+
+    // Per-worker tile of simulated days and moment accumulators, reused by every resample the worker runs
+    struct Scratch {
+        Eigen::MatrixXd Z, D, cross;
+        Eigen::VectorXd sum;
+    };
+    const int tile = 64;
+    ThreadPool pool;
+    std::vector<Scratch> scratch(pool.size());
+    std::vector<Eigen::RowVectorXd> resampled(num_resamples);
+
+    pool.parallel_for(num_resamples, [&](size_t r) {
+        Scratch& s = scratch[pool.worker_index()];
+        s.Z.resize(N, tile);
+        s.D.resize(N, tile);
+        s.cross.setZero(N, N);
+        s.sum.setZero(N);
+
+        // Fused simulate-and-accumulate: T days of shocks L z are drawn a
+        // tile at a time and folded into their sum and cross products, so
+        // the synthetic history itself never exists
+        Philox::Stream rng(seed, r);
+        for (int t = 0; t < T; t += tile) {
+            int days = std::min(tile, T - t);
+            rng.normals(s.Z.data(), (Eigen::Index)N * days);
+            s.D.leftCols(days).noalias() = factor * s.Z.leftCols(days);
+            s.sum += s.D.leftCols(days).rowwise().sum();
+            s.cross.selfadjointView<Eigen::Lower>().rankUpdate(s.D.leftCols(days));
+        }
+
+        // Shocks have mean zero, so accumulating them rather than the returns avoids cancellation
+        Eigen::VectorXd shock_mean = s.sum / T;
+        Eigen::MatrixXd resampled_covariance = s.cross.selfadjointView<Eigen::Lower>();
+        resampled_covariance.noalias() -= T * shock_mean * shock_mean.transpose();
+        resampled_covariance /= T - 1;
+        Eigen::RowVectorXd resampled_mean = mean + shock_mean.transpose();
+
+        resampled[r] = start;
+        sharpe_ascent(resampled_mean, resampled_covariance, resampled[r], num_epochs);
+    });
+
+    // Averaged in resample order, so the result does not depend on the thread count
+    Eigen::RowVectorXd average = Eigen::RowVectorXd::Zero(N);
+    for (const Eigen::RowVectorXd& w : resampled) average += w;
+    weights = average / average.sum();
+
+    double sharpe = weights.dot(mean) / std::sqrt(weights * covariance * weights.transpose());
+    sharpe_ratio = sharpe * std::sqrt(TRADING_DAYS);
+
+    return true;
+}
+
 void Portfolio::optimize_omega(uint32_t num_epochs) { 
-    KDE gauss_kernel("gaussian");
+    KDE gauss_kernel("gaussian_binned");
     unique_ptr<OptObjective> omega = make_unique<Omega>(gauss_kernel);
     BayesOptimizer bayes_opt(std::move(omega));
 
@@ -277,3 +351,49 @@ void Portfolio::optimize_omega(uint32_t num_epochs) {
     }
     std::cout << "]" << std::endl; 
 }
+
+bool Portfolio::optimize_omega_lp(double threshold) {
+    omega_lp.set_threshold(threshold);
+
+    Eigen::VectorXd new_weights;
+    if (!omega_lp.solve(returns, new_weights)) {
+        std::cerr << "Omega LP: no allocation beats the threshold " << threshold << std::endl;
+        return false;
+    }
+
+    weights = new_weights.transpose();
+    std::cout << "Omega LP: Omega = " << omega_lp.omega()
+              << " after " << omega_lp.iterations() << " iterations" << std::endl;
+    return true;
+}
+
+WealthStats Portfolio::simulate(int64_t num_paths, int num_steps, uint64_t seed, Sampler sampler,
+                                const VarianceReduction& reduction, const RebalancePolicy& rebalance) {
+    MonteCarloEngine engine(mean.transpose(), covariance);
+    engine.set_sampler(sampler);
+    engine.set_variance_reduction(reduction);
+    engine.set_rebalance(rebalance);
+    return engine.simulate(weights.transpose(), num_paths, num_steps, seed);
+}
+
+WealthStats Portfolio::bootstrap(int64_t num_paths, int num_steps, double mean_block_length,
+                                 BlockScheme scheme, uint64_t seed) {
+    BootstrapEngine engine(returns, mean_block_length, scheme);
+    return engine.simulate(weights.transpose(), num_paths, num_steps, seed);
+}
+
+RiskReport Portfolio::risk_report(const std::vector<int>& horizons, const std::vector<double>& levels) {
+    RiskEngine engine(returns, horizons, levels);
+    return engine.evaluate(weights);
+}
+
+bool Portfolio::sample_cloud(const std::string& path, int64_t num_portfolios, double concentration, uint64_t seed) {
+    PortfolioCloud cloud(mean, covariance, concentration);
+    CloudSummary summary;
+    if (!cloud.generate(num_portfolios, path, summary, seed)) {
+        std::cerr << "Portfolio cloud: could not write " << path << std::endl;
+        return false;
+    }
+    std::cout << summary;
+    return true;
+}
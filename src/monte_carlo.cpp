@@ -0,0 +1,324 @@
+#include <cmath>
+#include <cassert>
+#include <vector>
+#include <numeric>
+#include <queue>
+#include <optional>
+#include <algorithm>
+#include <Eigen/Dense>
+
+#include "monte_carlo.hpp"
+#include "sobol.hpp"
+#include "normal_dist.hpp"
+#include "philox.hpp"
+
+using namespace std;
+using namespace Eigen;
+
+MonteCarloEngine::MonteCarloEngine(const VectorXd& _mean, const MatrixXd& covariance, int _block_size, size_t num_threads)
+    : mean{_mean}, block_size{max(_block_size, 1)}, sampler{Sampler::PseudoRandom}, pool(num_threads)
+{
+    // Eigenvalues come out ascending; reversed, column 0 is the first principal component
+    SelfAdjointEigenSolver<MatrixXd> eig(covariance);
+    pc_factor = (eig.eigenvectors() * eig.eigenvalues().cwiseMax(0.0).cwiseSqrt().asDiagonal()).rowwise().reverse();
+
+    LLT<MatrixXd> llt(covariance);
+    if (llt.info() == Success) {
+        factor = llt.matrixL();
+    } else {
+        // Singular covariance (e.g. perfectly correlated assets): any square
+        // root will do, so take the principal-component one
+        factor = pc_factor;
+    }
+}
+
+using RowMatrixXd = Matrix<double, Dynamic, Dynamic, RowMajor>;
+using RowArrayXd = Array<double, 1, Dynamic>;
+
+// Brownian bridge over steps 0..S: W_S comes from the first normal, then each
+// midpoint given its interval's endpoints, breadth first, so the k-th normal
+// refines the path at an ever finer scale
+struct BrownianBridge {
+    vector<int> left, mid, right;
+    vector<double> w_left, w_right, sd;
+
+    BrownianBridge(int S) {
+        queue<pair<int, int>> intervals;
+        intervals.push({0, S});
+        while (!intervals.empty()) {
+            auto [l, r] = intervals.front();
+            intervals.pop();
+            if (r - l < 2) continue;
+            int m = (l + r) / 2;
+            left.push_back(l);
+            mid.push_back(m);
+            right.push_back(r);
+            w_left.push_back(double(r - m) / (r - l));
+            w_right.push_back(double(m - l) / (r - l));
+            sd.push_back(sqrt(double(m - l) * (r - m) / (r - l)));
+            intervals.push({l, m});
+            intervals.push({m, r});
+        }
+    }
+
+    // Z holds the normals of N independent paths per column in bridge order
+    // (row k * N + i is the k-th normal of path component i); W receives the
+    // Brownian values at steps 0..S in rows t * N .. t * N + N - 1
+    void build(const RowMatrixXd& Z, int N, RowMatrixXd& W) const {
+        int S = mid.size() + 1;
+        W.resize((S + 1) * N, Z.cols());
+        W.topRows(N).setZero();
+        W.middleRows(S * N, N) = sqrt(double(S)) * Z.topRows(N);
+        for (size_t k = 0; k < mid.size(); ++k) {
+            W.middleRows(mid[k] * N, N) = w_left[k] * W.middleRows(left[k] * N, N)
+                                        + w_right[k] * W.middleRows(right[k] * N, N)
+                                        + sd[k] * Z.middleRows((k + 1) * N, N);
+        }
+    }
+};
+
+WealthStats MonteCarloEngine::simulate(const VectorXd& weights, int64_t num_paths, int num_steps, uint64_t seed)
+{
+    int N = mean.size();
+    assert(weights.size() == N && "Weight dimension mismatch");
+    assert((rebalance.rule != Rebalance::Calendar || rebalance.period > 0) && "Rebalancing period must be positive");
+
+    bool qmc = sampler == Sampler::Sobol;
+    VarianceReduction vr = qmc ? VarianceReduction{} : reduction;
+    int64_t dims = (int64_t)N * num_steps;
+    int B = block_size;
+    if (qmc) {
+        while (B > 16 && dims * B > (1 << 19)) B /= 2;
+    }
+    if (vr.antithetic) B = max(2, B - B % 2);
+    int half = vr.antithetic ? B / 2 : B;   // independently drawn paths per block
+
+    optional<SobolSequence> sobol;
+    optional<BrownianBridge> bridge;
+    if (qmc) {
+        sobol.emplace((int)min<int64_t>(dims, SobolSequence::max_dimensions()), seed);
+        bridge.emplace(num_steps);
+    }
+
+    int64_t num_blocks = (num_paths + B - 1) / B;
+    if (vr.any()) num_paths = num_blocks * B;
+
+    // Per-block sums of wealth W and control X, reduced in block order afterwards
+    // so the estimate does not depend on the thread count
+    vector<double> sum_w(num_blocks), sum_x(num_blocks), sum_wx(num_blocks), sum_xx(num_blocks);
+    vector<double> sum_under_water(num_blocks), sum_rebalances(num_blocks), sum_costs(num_blocks);
+    const MatrixXd& shock_factor = vr.stratified ? pc_factor : factor;
+    double portfolio_mean = weights.dot(mean);
+
+    // Contiguous ranges of blocks balance load without queueing a task per
+    // block; each range keeps its own sketch of terminal wealth
+    int64_t num_tasks = min<int64_t>(num_blocks, summary_chunks);
+    vector<TDigest> sketches(num_tasks), drawdown_sketches(num_tasks);
+
+    pool.parallel_for(num_tasks, [&](size_t task) {
+        int64_t first = num_blocks * task / num_tasks;
+        int64_t last = num_blocks * (task + 1) / num_tasks;
+
+        MatrixXd Z(N, B), Z_half(N, half);
+        MatrixXd step_returns(N, B);
+        ArrayXXd holdings(N, B), trade(N, B);
+        RowVectorXd control(B);
+        RowArrayXd wealth(B), peak(B), drawdown(B), under_water(B), rebalances(B), costs(B), cost_paid(B);
+        Array<bool, 1, Dynamic> due(B);
+        MatrixXd pc1(num_steps, half);
+        RowMatrixXd U, bridge_normals, W;
+
+        for (int64_t block = first; block < last; ++block) {
+            Philox::Stream rng(seed, block);
+
+            if (qmc) {
+                int sobol_dims = sobol->dimensions();
+                sobol->generate(block * B, B, U);
+                bridge_normals.resize(dims, B);
+                Map<ArrayXd>(bridge_normals.data(), (Index)sobol_dims * B) =
+                    Normal::inv_cdf(Map<const ArrayXd>(U.data(), U.size()));
+                if (sobol_dims < dims) {
+                    MatrixXd rest(dims - sobol_dims, B);
+                    rng.normals(rest.data(), rest.size());
+                    bridge_normals.bottomRows(dims - sobol_dims) = rest;
+                }
+                bridge->build(bridge_normals, N, W);
+            }
+
+            if (vr.stratified) {
+                // Path j's standardized PC1 sum lies in stratum j of `half` equiprobable ones
+                ArrayXd u(half);
+                rng.uniforms(u.data(), half);
+                u = (u + ArrayXd::LinSpaced(half, 0, half - 1)) / half;
+                RowVectorXd pc1_sum = Normal::inv_cdf(u).matrix().transpose() * sqrt(double(num_steps));
+                rng.normals(pc1.data(), pc1.size());
+                pc1 = (pc1.rowwise() - pc1.colwise().mean()).rowwise() + pc1_sum / num_steps;
+            }
+
+            holdings.colwise() = weights.array();
+            wealth.setOnes();
+            peak.setOnes();
+            drawdown.setZero();
+            under_water.setZero();
+            rebalances.setZero();
+            costs.setZero();
+            control.setZero();
+            for (int t = 0; t < num_steps; ++t) {
+                if (qmc) {
+                    Z = W.middleRows((t + 1) * N, N) - W.middleRows(t * N, N);
+                } else {
+                    MatrixXd& drawn = vr.antithetic ? Z_half : Z;
+                    rng.normals(drawn.data(), drawn.size());
+                    if (vr.stratified) drawn.row(0) = pc1.row(t);
+                    if (vr.antithetic) Z << Z_half, -Z_half;
+                }
+                step_returns.noalias() = shock_factor * Z;
+                if (vr.control_variate) control.noalias() += weights.transpose() * step_returns;
+                holdings *= (1.0 + (step_returns.colwise() + mean).array());
+                wealth = holdings.colwise().sum();
+
+                bool calendar = rebalance.rule == Rebalance::Calendar;
+                if (rebalance.rule != Rebalance::None && t + 1 < num_steps
+                    && (!calendar || (t + 1) % rebalance.period == 0)) {
+                    // Trades to the targets at pre-cost wealth set the cost, and lanes
+                    // not due keep their holdings
+                    trade.matrix().noalias() = weights * wealth.matrix();
+                    trade -= holdings;
+                    if (calendar) {
+                        due.setConstant(true);
+                    } else {
+                        due = trade.abs().colwise().maxCoeff() > rebalance.band * wealth.abs();
+                    }
+                    cost_paid = due.select(rebalance.cost * trade.abs().colwise().sum(), 0.0);
+                    wealth -= cost_paid;
+                    costs += cost_paid;
+                    rebalances += due.cast<double>();
+                    trade.matrix().noalias() = weights * wealth.matrix();
+                    holdings = due.replicate(N, 1).select(trade, holdings);
+                }
+
+                peak = peak.max(wealth);
+                drawdown = drawdown.max(1.0 - wealth / peak);
+                under_water += (wealth < peak).cast<double>();
+            }
+
+            int64_t offset = block * B;
+            int count = (int)min<int64_t>(B, num_paths - offset);
+            sketches[task].add(wealth.data(), count);
+            drawdown_sketches[task].add(drawdown.data(), count);
+
+            control.array() += num_steps * portfolio_mean;
+            sum_w[block] = wealth.head(count).sum();
+            sum_x[block] = control.head(count).sum();
+            sum_wx[block] = wealth.head(count).matrix().dot(control.head(count));
+            sum_xx[block] = control.head(count).squaredNorm();
+            sum_under_water[block] = under_water.head(count).sum();
+            sum_rebalances[block] = rebalances.head(count).sum();
+            sum_costs[block] = costs.head(count).sum();
+        }
+        sketches[task].compress();
+        drawdown_sketches[task].compress();
+    });
+
+    // Control-variate coefficient beta = cov(W, X) / var(X) over all paths
+    double beta = 0.0;
+    double control_mean = num_steps * portfolio_mean;
+    if (vr.control_variate) {
+        double n = num_paths;
+        double w_bar = accumulate(sum_w.begin(), sum_w.end(), 0.0) / n;
+        double x_bar = accumulate(sum_x.begin(), sum_x.end(), 0.0) / n;
+        double cov = accumulate(sum_wx.begin(), sum_wx.end(), 0.0) / n - w_bar * x_bar;
+        double var = accumulate(sum_xx.begin(), sum_xx.end(), 0.0) / n - x_bar * x_bar;
+        if (var > 0.0) beta = cov / var;
+    }
+
+    TDigest digest;
+    for (const TDigest& sketch : sketches) digest.merge(sketch);
+    WealthStats stats = summarize(digest);
+    double plain_variance = stats.std_dev * stats.std_dev / max<int64_t>(num_paths, 1);
+    stats.mean_std_error = sqrt(plain_variance);
+
+    TDigest drawdowns;
+    for (const TDigest& sketch : drawdown_sketches) drawdowns.merge(sketch);
+    double n = max<int64_t>(num_paths, 1);
+    stats.mean_max_drawdown = drawdowns.mean();
+    stats.drawdown_quantiles = stats.quantile_levels.unaryExpr([&](double q) { return drawdowns.quantile(q); });
+    stats.mean_time_under_water = accumulate(sum_under_water.begin(), sum_under_water.end(), 0.0) / (n * max(num_steps, 1));
+    stats.mean_rebalances = accumulate(sum_rebalances.begin(), sum_rebalances.end(), 0.0) / n;
+    stats.mean_costs = accumulate(sum_costs.begin(), sum_costs.end(), 0.0) / n;
+
+    if (vr.any() && num_blocks > 1) {
+        // Block means are i.i.d. unbiased estimates whatever the technique,
+        // so their spread measures the variance actually achieved
+        ArrayXd block_means(num_blocks);
+        for (int64_t b = 0; b < num_blocks; ++b) {
+            block_means(b) = (sum_w[b] - beta * (sum_x[b] - B * control_mean)) / B;
+        }
+        stats.mean = block_means.mean();
+        double achieved = (block_means - stats.mean).square().sum() / (num_blocks - 1) / num_blocks;
+        stats.mean_std_error = sqrt(achieved);
+        if (achieved > 0.0) stats.variance_reduction = plain_variance / achieved;
+    }
+
+    return stats;
+}
+
+WealthStats MonteCarloEngine::summarize(const TDigest& digest)
+{
+    WealthStats stats;
+    stats.num_paths = (int64_t)digest.count();
+    if (stats.num_paths == 0) return stats;
+
+    stats.mean = digest.mean();
+    stats.std_dev = sqrt(digest.variance());
+    stats.min = digest.min();
+    stats.max = digest.max();
+    stats.prob_loss = digest.cdf(1.0);
+
+    stats.quantile_levels.resize(7);
+    stats.quantile_levels << 0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99;
+    stats.quantiles = stats.quantile_levels.unaryExpr([&](double q) { return digest.quantile(q); });
+    stats.var_95 = 1.0 - digest.quantile(0.05);
+    stats.cvar_95 = 1.0 - digest.tail_mean(0.05);
+
+    const int bins = 20;
+    stats.histogram_edges = VectorXd::LinSpaced(bins + 1, digest.quantile(0.001), digest.quantile(0.999));
+    stats.histogram = digest.histogram(stats.histogram_edges);
+
+    return stats;
+}
+
+ostream& operator<<(ostream& os, const WealthStats& stats)
+{
+    os << "Terminal wealth over " << stats.num_paths << " paths:" << endl
+       << "  mean = " << stats.mean << ", std = " << stats.std_dev
+       << ", min = " << stats.min << ", max = " << stats.max << endl;
+    os << "  quantiles:";
+    for (Index k = 0; k < stats.quantiles.size(); ++k) {
+        os << " q" << stats.quantile_levels(k) << " = " << stats.quantiles(k);
+    }
+    os << endl
+       << "  VaR(95%) = " << stats.var_95 << ", CVaR(95%) = " << stats.cvar_95
+       << ", P(loss) = " << stats.prob_loss << endl
+       << "  mean standard error = " << stats.mean_std_error
+       << " (variance reduction x" << stats.variance_reduction << ")" << endl;
+    if (stats.drawdown_quantiles.size() > 0) {
+        os << "  max drawdown: mean = " << stats.mean_max_drawdown;
+        for (Index k = 0; k < stats.drawdown_quantiles.size(); ++k) {
+            os << " q" << stats.quantile_levels(k) << " = " << stats.drawdown_quantiles(k);
+        }
+        os << endl
+           << "  time under water = " << stats.mean_time_under_water
+           << ", rebalances per path = " << stats.mean_rebalances
+           << ", costs paid = " << stats.mean_costs << endl;
+    }
+    if (stats.histogram.size() > 0) {
+        os << "  histogram over [" << stats.histogram_edges(0) << ", "
+           << stats.histogram_edges(stats.histogram_edges.size() - 1) << "), % of paths per bin:";
+        for (Index j = 0; j < stats.histogram.size(); ++j) {
+            os << " " << 100.0 * stats.histogram(j) / stats.num_paths;
+        }
+        os << endl;
+    }
+    return os;
+}
@@ -0,0 +1,237 @@
+#include <cmath>
+#include <algorithm>
+#include <Eigen/Dense>
+
+#include "omega_lp.hpp"
+
+using namespace std;
+using namespace Eigen;
+
+// Scenario data in the layout the solver works in. Primal variables are
+// ordered [y (N), s, e (T), z (T)] and constraint rows [t (T), budget, scale].
+struct OmegaProblem {
+    int T, N;
+    double tau;
+    MatrixXd G;         // T x (N + 1): [R | -tau], the y and s columns of the scenario rows
+    VectorXd mu;        // N, mean asset returns
+    VectorXd g_budget;  // N + 1: [1 ... 1, -1], the y and s columns of the budget row
+
+    OmegaProblem(const MatrixXd& asset_returns, double _tau)
+        : T(asset_returns.cols()), N(asset_returns.rows()), tau{_tau}, G(T, N + 1), g_budget(N + 1) {
+        G.leftCols(N) = asset_returns.transpose();
+        G.col(N).setConstant(-tau);
+        mu = asset_returns.rowwise().mean();
+        g_budget.head(N).setOnes();
+        g_budget(N) = -1.0;
+    }
+
+    int num_vars() const { return N + 1 + 2 * T; }
+    int num_rows() const { return T + 2; }
+
+    VectorXd A(const VectorXd& x) const {
+        VectorXd r(num_rows());
+        r.head(T) = G * x.head(N + 1) + x.segment(N + 1, T) - x.tail(T);
+        r(T) = g_budget.dot(x.head(N + 1));
+        r(T + 1) = x.segment(N + 1, T).sum() / T;
+        return r;
+    }
+
+    VectorXd At(const VectorXd& lambda) const {
+        VectorXd r(num_vars());
+        r.head(N + 1) = G.transpose() * lambda.head(T) + lambda(T) * g_budget;
+        r.segment(N + 1, T) = lambda.head(T).array() + lambda(T + 1) / T;
+        r.tail(T) = -lambda.head(T);
+        return r;
+    }
+};
+
+// Solves (A D A^T) dl = r for diagonal D > 0. Scenario rows carry
+// P = Lambda + G D_G G^T, with Lambda = D_e + D_z diagonal, which Woodbury
+// inverts through the (N + 1) x (N + 1) matrix H = D_G^-1 + G^T Lambda^-1 G;
+// the two budget rows are then eliminated by a 2 x 2 Schur complement.
+class NormalSolver {
+    const OmegaProblem& prob;
+    VectorXd d;
+    VectorXd lambda_inv;
+    LDLT<MatrixXd> H;
+    VectorXd u, v, Pu, Pv;
+    Matrix2d schur;
+
+    VectorXd P_inverse(const VectorXd& r) const {
+        VectorXd scaled = lambda_inv.cwiseProduct(r);
+        VectorXd correction = prob.G * H.solve(prob.G.transpose() * scaled);
+        return scaled - lambda_inv.cwiseProduct(correction);
+    }
+
+    VectorXd solve_once(const VectorXd& r) const {
+        int T = prob.T;
+        VectorXd Pr = P_inverse(r.head(T));
+        Vector2d rhs(r(T) - u.dot(Pr), r(T + 1) - v.dot(Pr));
+        Vector2d budget = schur.partialPivLu().solve(rhs);
+
+        VectorXd dl(T + 2);
+        dl.head(T) = Pr - budget(0) * Pu - budget(1) * Pv;
+        dl.tail(2) = budget;
+        return dl;
+    }
+
+public:
+    NormalSolver(const OmegaProblem& _prob) : prob(_prob) {}
+
+    void factor(const VectorXd& _d) {
+        d = _d;
+        int T = prob.T, N = prob.N;
+        VectorXd d_G = d.head(N + 1);
+        VectorXd d_e = d.segment(N + 1, T);
+        lambda_inv = (d_e + d.tail(T)).cwiseInverse();
+
+        MatrixXd G_scaled = lambda_inv.cwiseSqrt().asDiagonal() * prob.G;
+        MatrixXd H_mat = MatrixXd(d_G.cwiseInverse().asDiagonal());
+        H_mat.selfadjointView<Lower>().rankUpdate(G_scaled.transpose());
+        H.compute(H_mat.selfadjointView<Lower>());
+
+        u = prob.G * d_G.cwiseProduct(prob.g_budget);
+        v = d_e / T;
+        Pu = P_inverse(u);
+        Pv = P_inverse(v);
+        schur << d_G.sum() - u.dot(Pu), -u.dot(Pv),
+                 -v.dot(Pu), d_e.sum() / (double(T) * T) - v.dot(Pv);
+    }
+
+    // Iterative refinement against the matrix-free product recovers the
+    // digits lost to cancellation in the Schur complement near the optimum
+    VectorXd solve(const VectorXd& r) const {
+        VectorXd dl = solve_once(r);
+        for (int k = 0; k < 4; ++k) {
+            VectorXd residual = r - prob.A(d.cwiseProduct(prob.At(dl)));
+            if (residual.norm() <= 1e-14 * r.norm()) break;
+            dl += solve_once(residual);
+        }
+        return dl;
+    }
+};
+
+// Largest step in (0, 1] keeping v + alpha dv >= 0
+static double max_step(const VectorXd& v, const VectorXd& dv)
+{
+    double alpha = 1.0;
+    for (int i = 0; i < v.size(); ++i) {
+        if (dv(i) < 0.0) alpha = min(alpha, -v(i) / dv(i));
+    }
+    return alpha;
+}
+
+bool OmegaLP::solve(const MatrixXd& asset_returns, VectorXd& weights)
+{
+    OmegaProblem prob(asset_returns, threshold);
+    int T = prob.T, N = prob.N;
+    int n = prob.num_vars();
+    num_iters = 0;
+
+    // Long-only, so the best achievable mean is the best single asset's
+    if (prob.mu.maxCoeff() <= threshold) return false;
+
+    VectorXd b = VectorXd::Zero(T + 2);
+    b(T + 1) = 1.0;
+    VectorXd c = VectorXd::Zero(n);
+    c.head(N) = -prob.mu;
+    c(N) = threshold;
+
+    VectorXd x, lambda, s;
+    if (x_prev.size() == n) {
+        // Warm start: the previous optimum pushed back off the boundary
+        // so the iterates start near the central path
+        double shift = 1e-2 * max(1.0, x_prev.mean());
+        x = x_prev.array() + shift;
+        s = s_prev.array() + 1e-2 * max(1e-2, s_prev.mean());
+        lambda = lambda_prev;
+    } else {
+        // Cold start from equal weights scaled so E[loss] is about 1, with
+        // the scenario rows satisfied exactly and every variable >= 1 apart from y
+        VectorXd w = VectorXd::Constant(N, 1.0 / N);
+        ArrayXd excess = (asset_returns.transpose() * w).array() - threshold;
+        double scale = 1.0 / max((-excess).max(0.0).mean(), 1e-8);
+
+        x.resize(n);
+        x.head(N) = scale * w;
+        x(N) = scale;
+        x.segment(N + 1, T) = scale * (-excess).max(0.0) + 1.0;
+        x.tail(T) = scale * excess.max(0.0) + 1.0;
+        lambda = VectorXd::Zero(T + 2);
+        s = VectorXd::Ones(n);
+    }
+
+    NormalSolver normal(prob);
+    VectorXd x_best = x, lambda_best = lambda, s_best = s;
+    double best_error = INFINITY;
+
+    for (; num_iters < max_iters; ++num_iters) {
+        VectorXd r_p = b - prob.A(x);
+        VectorXd r_d = c - prob.At(lambda) - s;
+        double mu_gap = x.dot(s) / n;
+        double primal_obj = c.dot(x);
+        double dual_obj = b.dot(lambda);
+
+        // Iterates running off to infinity mean Omega itself is unbounded
+        if (!x.allFinite() || !s.allFinite() || x.maxCoeff() > 1e14) break;
+
+        double error = max({r_p.norm() / (1.0 + b.norm()),
+                            r_d.norm() / (1.0 + c.norm()),
+                            abs(primal_obj - dual_obj) / (1.0 + abs(primal_obj))});
+        if (error < best_error) {
+            best_error = error;
+            x_best = x;
+            lambda_best = lambda;
+            s_best = s;
+        } else if (error > 1e3 * best_error) {
+            // The normal equations have become too ill-conditioned to make progress
+            break;
+        }
+        if (error < tolerance) break;
+
+        VectorXd d = x.cwiseQuotient(s);
+        normal.factor(d);
+
+        auto newton = [&](const VectorXd& r_xs, VectorXd& dx, VectorXd& dl, VectorXd& ds) {
+            VectorXd rhs = r_p - prob.A(r_xs.cwiseQuotient(s)) + prob.A(d.cwiseProduct(r_d));
+            dl = normal.solve(rhs);
+            ds = r_d - prob.At(dl);
+            dx = (r_xs - x.cwiseProduct(ds)).cwiseQuotient(s);
+        };
+
+        // Predictor: pure Newton step towards complementarity
+        VectorXd dx, dl, ds;
+        VectorXd xs = x.cwiseProduct(s);
+        newton(-xs, dx, dl, ds);
+        double alpha_p = max_step(x, dx);
+        double alpha_d = max_step(s, ds);
+        double mu_aff = (x + alpha_p * dx).dot(s + alpha_d * ds) / n;
+        double sigma = pow(mu_aff / mu_gap, 3);
+
+        // Corrector: centring plus the second-order term of the predictor
+        VectorXd r_xs = (sigma * mu_gap - xs.array() - dx.cwiseProduct(ds).array()).matrix();
+        newton(r_xs, dx, dl, ds);
+        alpha_p = min(1.0, 0.995 * max_step(x, dx));
+        alpha_d = min(1.0, 0.995 * max_step(s, ds));
+
+        x += alpha_p * dx;
+        lambda += alpha_d * dl;
+        s += alpha_d * ds;
+    }
+
+    // Stalling just short of the tolerance in floating point still pins Omega
+    // down to ~best_error, so accept anything within a factor of 100
+    x = x_best;
+    if (best_error > 100.0 * tolerance || x(N) <= 0.0) return false;
+
+    x_prev = x;
+    lambda_prev = lambda_best;
+    s_prev = s_best;
+
+    weights = (x.head(N) / x(N)).cwiseMax(0.0);
+    weights /= weights.sum();
+
+    ArrayXd excess = (asset_returns.transpose() * weights).array() - threshold;
+    omega_value = excess.max(0.0).sum() / (-excess).max(0.0).sum();
+    return true;
+}
@@ -0,0 +1,249 @@
+#include <cmath>
+#include <algorithm>
+#include <Eigen/Dense>
+
+#include "philox.hpp"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define PHILOX_X86
+#endif
+
+using namespace std;
+using namespace Eigen;
+
+namespace Philox
+{
+    static void generate_scalar(uint64_t seed, uint64_t stream, uint64_t first, int64_t count, uint64_t *words)
+    {
+        for (int64_t i = 0; i < count; ++i) {
+            Block b = generate(seed, stream, first + i);
+            words[2 * i] = b[0] | (uint64_t)b[1] << 32;
+            words[2 * i + 1] = b[2] | (uint64_t)b[3] << 32;
+        }
+    }
+
+#ifdef PHILOX_X86
+    // One counter per 64-bit lane, each 32-bit state word in the low half of
+    // its lane; mul_epu32 gives the full 32 x 32 -> 64 products directly
+    __attribute__((target("avx2")))
+    static void generate_avx2(uint64_t seed, uint64_t stream, uint64_t first, int64_t count, uint64_t *words)
+    {
+        const __m256i low = _mm256_set1_epi64x(0xffffffffll);
+        const __m256i m0 = _mm256_set1_epi64x(mul_0), m1 = _mm256_set1_epi64x(mul_1);
+        const __m256i s0 = _mm256_set1_epi64x((uint32_t)stream), s1 = _mm256_set1_epi64x(stream >> 32);
+
+        int64_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m256i c = _mm256_add_epi64(_mm256_set1_epi64x(first + i), _mm256_setr_epi64x(0, 1, 2, 3));
+            __m256i x0 = _mm256_and_si256(c, low), x1 = _mm256_srli_epi64(c, 32), x2 = s0, x3 = s1;
+            uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+            for (int round = 0; round < 10; ++round) {
+                __m256i p0 = _mm256_mul_epu32(x0, m0);
+                __m256i p1 = _mm256_mul_epu32(x2, m1);
+                x0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p1, 32), x1), _mm256_set1_epi64x(k0));
+                x1 = _mm256_and_si256(p1, low);
+                x2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p0, 32), x3), _mm256_set1_epi64x(k1));
+                x3 = _mm256_and_si256(p0, low);
+                k0 += weyl_0;
+                k1 += weyl_1;
+            }
+            __m256i w0 = _mm256_or_si256(x0, _mm256_slli_epi64(x1, 32));
+            __m256i w1 = _mm256_or_si256(x2, _mm256_slli_epi64(x3, 32));
+            // Interleave to word order: lo0 hi0 lo1 hi1 | lo2 hi2 lo3 hi3
+            __m256i a = _mm256_unpacklo_epi64(w0, w1), b = _mm256_unpackhi_epi64(w0, w1);
+            _mm256_storeu_si256((__m256i *)(words + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256((__m256i *)(words + 2 * i + 4), _mm256_permute2x128_si256(a, b, 0x31));
+        }
+        generate_scalar(seed, stream, first + i, count - i, words + 2 * i);
+    }
+
+    __attribute__((target("avx512f")))
+    static void generate_avx512(uint64_t seed, uint64_t stream, uint64_t first, int64_t count, uint64_t *words)
+    {
+        const __m512i low = _mm512_set1_epi64(0xffffffffll);
+        const __m512i m0 = _mm512_set1_epi64(mul_0), m1 = _mm512_set1_epi64(mul_1);
+        const __m512i s0 = _mm512_set1_epi64((uint32_t)stream), s1 = _mm512_set1_epi64(stream >> 32);
+        const __m512i lanes = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m512i first_half = _mm512_setr_epi64(0, 8, 1, 9, 2, 10, 3, 11);
+        const __m512i second_half = _mm512_setr_epi64(4, 12, 5, 13, 6, 14, 7, 15);
+
+        int64_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m512i c = _mm512_add_epi64(_mm512_set1_epi64(first + i), lanes);
+            __m512i x0 = _mm512_and_si512(c, low), x1 = _mm512_srli_epi64(c, 32), x2 = s0, x3 = s1;
+            uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+            for (int round = 0; round < 10; ++round) {
+                __m512i p0 = _mm512_mul_epu32(x0, m0);
+                __m512i p1 = _mm512_mul_epu32(x2, m1);
+                x0 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p1, 32), x1), _mm512_set1_epi64(k0));
+                x1 = _mm512_and_si512(p1, low);
+                x2 = _mm512_xor_si512(_mm512_xor_si512(_mm512_srli_epi64(p0, 32), x3), _mm512_set1_epi64(k1));
+                x3 = _mm512_and_si512(p0, low);
+                k0 += weyl_0;
+                k1 += weyl_1;
+            }
+            __m512i w0 = _mm512_or_si512(x0, _mm512_slli_epi64(x1, 32));
+            __m512i w1 = _mm512_or_si512(x2, _mm512_slli_epi64(x3, 32));
+            _mm512_storeu_si512(words + 2 * i, _mm512_permutex2var_epi64(w0, first_half, w1));
+            _mm512_storeu_si512(words + 2 * i + 8, _mm512_permutex2var_epi64(w0, second_half, w1));
+        }
+        generate_scalar(seed, stream, first + i, count - i, words + 2 * i);
+    }
+#endif
+
+    using GenerateFn = void (*)(uint64_t, uint64_t, uint64_t, int64_t, uint64_t *);
+
+    struct Dispatch {
+        GenerateFn fn;
+        const char *name;
+    };
+
+    static Dispatch select_isa()
+    {
+#ifdef PHILOX_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return {generate_avx512, "avx512f"};
+        if (__builtin_cpu_supports("avx2")) return {generate_avx2, "avx2"};
+#endif
+        return {generate_scalar, "scalar"};
+    }
+
+    static const Dispatch& dispatch()
+    {
+        static const Dispatch selected = select_isa();
+        return selected;
+    }
+
+    void generate(uint64_t seed, uint64_t stream, uint64_t first, int64_t count, uint64_t *words)
+    {
+        dispatch().fn(seed, stream, first, count, words);
+    }
+
+    const char *isa_name()
+    {
+        return dispatch().name;
+    }
+
+    // Box-Muller runs on groups of this many blocks. A fixed-size array is
+    // evaluated entirely in packets, never in a scalar tail, so every lane
+    // sees the same log and the same rounding.
+    static constexpr int lanes = 8;
+    using Lanes = Array<double, lanes, 1>;
+
+    // Taylor coefficients of sin x / x and cos x in x^2; on |x| <= pi/4 the
+    // truncation errors are below 5e-17 and 3e-18
+    static constexpr double sin_c[8] = {
+        1.0, -1.0 / 6, 1.0 / 120, -1.0 / 5040, 1.0 / 362880, -1.0 / 39916800,
+        1.0 / 6227020800, -1.0 / 1307674368000
+    };
+    static constexpr double cos_c[9] = {
+        1.0, -1.0 / 2, 1.0 / 24, -1.0 / 720, 1.0 / 40320, -1.0 / 3628800,
+        1.0 / 479001600, -1.0 / 87178291200, 1.0 / 20922789888000
+    };
+
+    // 2 lanes words -> 2 lanes normals in block order, cosine branch first
+    static void box_muller(const uint64_t *words, double *out)
+    {
+        Lanes u1, u2;
+        for (int i = 0; i < lanes; ++i) {
+            u1(i) = to_uniform(words[2 * i]);
+            u2(i) = to_uniform(words[2 * i + 1]);
+        }
+        Lanes radius = (-2.0 * u1.log()).sqrt();
+
+        // 2 pi u2 = (q + f) pi / 2 with q = round(4 u2) in 0..4, f in [-1/2, 1/2]; both exact
+        Lanes q = (4.0 * u2).round();
+        Lanes x = (4.0 * u2 - q) * (M_PI / 2);
+        Lanes x2 = x.square();
+        Lanes s = Lanes::Constant(sin_c[7]);
+        for (int k = 6; k >= 0; --k) s = s * x2 + sin_c[k];
+        s *= x;
+        Lanes c = Lanes::Constant(cos_c[8]);
+        for (int k = 7; k >= 0; --k) c = c * x2 + cos_c[k];
+
+        // Rotate (cos x, sin x) by q quarter turns
+        Lanes cos_t = (q == 1.0).select(-s, (q == 2.0).select(-c, (q == 3.0).select(s, c)));
+        Lanes sin_t = (q == 1.0).select(c, (q == 2.0).select(-s, (q == 3.0).select(-c, s)));
+        Map<Lanes, 0, InnerStride<2>> even(out), odd(out + 1);
+        even = radius * cos_t;
+        odd = radius * sin_t;
+    }
+
+    double normal(uint64_t seed, uint64_t stream, uint64_t index)
+    {
+        uint64_t words[2 * lanes] = {};
+        double z[2 * lanes];
+        generate(seed, stream, index / 2, 1, words);
+        box_muller(words, z);
+        return z[index % 2];
+    }
+
+    uint64_t Stream::next_word()
+    {
+        pair_open = false;
+        uint64_t counter = position / 2;
+        if (counter != cached_counter) {
+            generate(seed, stream, counter, 1, cached_words);
+            cached_counter = counter;
+        }
+        return cached_words[position++ % 2];
+    }
+
+    double Stream::exponential()
+    {
+        return -log(uniform());
+    }
+
+    double Stream::normal()
+    {
+        double z;
+        normals(&z, 1);
+        return z;
+    }
+
+    // Words are produced a chunk at a time into fixed buffers, so draws never allocate
+    static constexpr int chunk_blocks = 32 * lanes;
+
+    void Stream::uniforms(double *out, Index n)
+    {
+        uint64_t words[2 * chunk_blocks];
+        Index done = 0;
+        if (position % 2 && n > 0) out[done++] = uniform();
+        while (done < n) {
+            int64_t blocks = min<int64_t>(chunk_blocks, (n - done + 1) / 2);
+            generate(seed, stream, position / 2, blocks, words);
+            Index m = min<Index>(2 * blocks, n - done);
+            for (Index i = 0; i < m; ++i) out[done + i] = to_uniform(words[i]);
+            done += m;
+            position += m;
+        }
+        pair_open = false;
+    }
+
+    void Stream::normals(double *out, Index n)
+    {
+        if (n <= 0) return;
+        if (position % 2 && !pair_open) ++position;
+
+        uint64_t words[2 * chunk_blocks];
+        double z[2 * chunk_blocks];
+        // Finish the pair whose cosine branch the previous run took
+        Index skip = position % 2;
+        position -= skip;
+
+        Index done = 0;
+        while (done < n) {
+            int64_t wanted = (skip + n - done + 1) / 2;
+            int64_t blocks = min<int64_t>(chunk_blocks, (wanted + lanes - 1) / lanes * lanes);
+            generate(seed, stream, position / 2, blocks, words);
+            for (int64_t g = 0; g < blocks; g += lanes) box_muller(words + 2 * g, z + 2 * g);
+            Index m = min<Index>(2 * blocks - skip, n - done);
+            copy(z + skip, z + skip + m, out + done);
+            done += m;
+            position += skip + m;
+            skip = 0;
+        }
+        pair_open = position % 2;
+    }
+}
@@ -0,0 +1,158 @@
+#include <cmath>
+#include <cstring>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <Eigen/Dense>
+
+#include "portfolio_cloud.hpp"
+#include "philox.hpp"
+
+using namespace std;
+using namespace Eigen;
+
+static constexpr size_t header_bytes = 24;
+static constexpr size_t l2_budget = 256 * 1024;
+
+PortfolioCloud::PortfolioCloud(const RowVectorXd& _mean, const MatrixXd& _covariance,
+                               double _concentration, int _tile_size, size_t num_threads)
+    : mean{_mean}, covariance{_covariance}, concentration{_concentration}, tile_size{_tile_size},
+      pool(num_threads)
+{
+    if (tile_size <= 0) {
+        // Per row: W and W cov in doubles, the record in floats
+        size_t row_bytes = 16 * mean.size() + 4 * (mean.size() + 3);
+        tile_size = (int)clamp<size_t>(l2_budget / row_bytes / 16 * 16, 16, 4096);
+    }
+}
+
+// Marsaglia-Tsang (2000) for shape >= 1; shape < 1 through G(shape + 1) U^(1 / shape)
+static double gamma_variate(Philox::Stream& rng, double shape)
+{
+    if (shape < 1.0) return gamma_variate(rng, shape + 1.0) * pow(rng.uniform(), 1.0 / shape);
+    double d = shape - 1.0 / 3.0, c = 1.0 / sqrt(9.0 * d);
+    while (true) {
+        double z = rng.normal();
+        double v = 1.0 + c * z;
+        if (v <= 0.0) continue;
+        v = v * v * v;
+        if (log(rng.uniform()) < 0.5 * z * z + d - d * v + d * log(v)) return d * v;
+    }
+}
+
+bool PortfolioCloud::generate(int64_t num_portfolios, const string& path, CloudSummary& summary, uint64_t seed)
+{
+    int N = mean.size();
+    uint32_t record_floats = N + 3;
+    uint32_t record_bytes = record_floats * sizeof(float);
+
+    int fd = -1;
+    if (!path.empty()) {
+        fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        char header[header_bytes] = {};
+        uint32_t num_assets = N;
+        uint64_t count = num_portfolios;
+        memcpy(header, "PFCLOUD1", 8);
+        memcpy(header + 8, &num_assets, 4);
+        memcpy(header + 12, &record_bytes, 4);
+        memcpy(header + 16, &count, 8);
+        if (pwrite(fd, header, header_bytes, 0) != (ssize_t)header_bytes) {
+            close(fd);
+            return false;
+        }
+    }
+
+    // Per-worker tile buffers, reused by every tile the worker takes
+    struct Scratch {
+        MatrixXd W, WS;
+        VectorXd ret, vol;
+        vector<float> records;
+    };
+    vector<Scratch> scratch(pool.size());
+
+    // Per-tile extremes, reduced in tile order afterwards
+    int64_t num_tiles = (num_portfolios + tile_size - 1) / tile_size;
+    vector<double> tile_sharpe(num_tiles), tile_vol(num_tiles);
+    vector<VectorXd> tile_sharpe_weights(num_tiles), tile_vol_weights(num_tiles);
+    atomic<bool> write_failed{false};
+
+    pool.parallel_for(num_tiles, [&](size_t tile) {
+        Scratch& s = scratch[pool.worker_index()];
+        int64_t first = tile * tile_size;
+        int B = (int)min<int64_t>(tile_size, num_portfolios - first);
+        s.W.resize(B, N);
+
+        Philox::Stream rng(seed, tile);
+        if (concentration == 1.0) {
+            // Gamma(1) is exponential: one bulk uniform draw and a vectorized log
+            rng.uniforms(s.W.data(), s.W.size());
+            s.W = -s.W.array().log();
+        } else {
+            for (Index k = 0; k < s.W.size(); ++k) s.W.data()[k] = gamma_variate(rng, concentration);
+        }
+        s.W.array().colwise() /= s.W.rowwise().sum().array();
+
+        s.ret.noalias() = s.W * mean.transpose();
+        s.WS.noalias() = s.W * covariance;
+        s.vol = (s.WS.array() * s.W.array()).rowwise().sum().max(0.0).sqrt();
+
+        Index best_sharpe = 0, best_vol = 0;
+        for (int i = 0; i < B; ++i) {
+            if (s.ret(i) / s.vol(i) > s.ret(best_sharpe) / s.vol(best_sharpe)) best_sharpe = i;
+            if (s.vol(i) < s.vol(best_vol)) best_vol = i;
+        }
+        tile_sharpe[tile] = s.ret(best_sharpe) / s.vol(best_sharpe);
+        tile_sharpe_weights[tile] = s.W.row(best_sharpe).transpose();
+        tile_vol[tile] = s.vol(best_vol);
+        tile_vol_weights[tile] = s.W.row(best_vol).transpose();
+
+        if (fd < 0) return;
+        s.records.resize((size_t)B * record_floats);
+        Map<Matrix<float, Dynamic, Dynamic, RowMajor>> records(s.records.data(), B, record_floats);
+        records.col(0) = s.ret.cast<float>();
+        records.col(1) = s.vol.cast<float>();
+        records.col(2) = (s.ret.array() / s.vol.array()).cast<float>().matrix();
+        records.rightCols(N) = s.W.cast<float>();
+
+        size_t bytes = (size_t)B * record_bytes;
+        off_t offset = header_bytes + (off_t)first * record_bytes;
+        for (size_t done = 0; done < bytes; ) {
+            ssize_t written = pwrite(fd, (const char *)s.records.data() + done, bytes - done, offset + done);
+            if (written <= 0) {
+                write_failed = true;
+                return;
+            }
+            done += written;
+        }
+    });
+
+    if (fd >= 0 && close(fd) != 0) write_failed = true;
+
+    summary = CloudSummary();
+    summary.num_portfolios = num_portfolios;
+    for (int64_t t = 0; t < num_tiles; ++t) {
+        if (t == 0 || tile_sharpe[t] > summary.max_sharpe) {
+            summary.max_sharpe = tile_sharpe[t];
+            summary.max_sharpe_weights = tile_sharpe_weights[t];
+        }
+        if (t == 0 || tile_vol[t] < summary.min_volatility) {
+            summary.min_volatility = tile_vol[t];
+            summary.min_volatility_weights = tile_vol_weights[t];
+        }
+    }
+
+    return !write_failed;
+}
+
+ostream& operator<<(ostream& os, const CloudSummary& summary)
+{
+    os << "Random portfolio cloud of " << summary.num_portfolios << " allocations:" << endl
+       << "  max daily Sharpe = " << summary.max_sharpe
+       << " at [ " << summary.max_sharpe_weights.transpose() << " ]" << endl
+       << "  min daily volatility = " << summary.min_volatility
+       << " at [ " << summary.min_volatility_weights.transpose() << " ]" << endl;
+    return os;
+}
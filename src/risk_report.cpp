@@ -0,0 +1,214 @@
+#include <cmath>
+#include <cassert>
+#include <iomanip>
+#include <numeric>
+#include <vector>
+#include <algorithm>
+#include <Eigen/Dense>
+
+#include "risk_report.hpp"
+#include "normal_dist.hpp"
+#include "philox.hpp"
+
+using namespace std;
+using namespace Eigen;
+
+RiskEngine::RiskEngine(const MatrixXd& asset_returns, vector<int> _horizons, vector<double> _levels,
+                       int64_t num_scenarios, uint64_t seed, int _chunk_size, size_t num_threads)
+    : horizons{std::move(_horizons)}, levels{std::move(_levels)}, returns{asset_returns},
+      chunk_size{max(_chunk_size, 1)}, pool(num_threads)
+{
+    int N = returns.rows();
+    int T = returns.cols();
+    assert(T > 1 && "Risk estimates need at least two days of returns");
+    for (double c : levels) assert(c > 0.0 && c < 1.0 && "Confidence levels lie in (0, 1)");
+
+    sort(horizons.begin(), horizons.end());
+    horizons.erase(unique(horizons.begin(), horizons.end()), horizons.end());
+    assert(!horizons.empty() && horizons.front() > 0 && "Horizons are positive day counts");
+
+    level_order.resize(levels.size());
+    iota(level_order.begin(), level_order.end(), 0);
+    sort(level_order.begin(), level_order.end(), [&](int a, int b) { return levels[a] < levels[b]; });
+
+    // Overlapping windows from prefix sums of log growth; windows longer than the sample are left empty
+    MatrixXd log_growth(N, T + 1);
+    log_growth.col(0).setZero();
+    for (int t = 0; t < T; ++t) log_growth.col(t + 1) = log_growth.col(t) + returns.col(t).array().log1p().matrix();
+    for (int h : horizons) {
+        int windows = max(T - h + 1, 0);
+        if (h == 1) {
+            historical.push_back(returns);
+        } else {
+            historical.push_back(((log_growth.rightCols(windows) - log_growth.middleCols(0, windows)).array().exp() - 1.0).matrix());
+        }
+    }
+
+    VectorXd mean = returns.rowwise().mean();
+    MatrixXd centered = returns.colwise() - mean;
+    MatrixXd covariance = centered * centered.transpose() / (T - 1);
+    MatrixXd factor;
+    LLT<MatrixXd> llt(covariance);
+    if (llt.info() == Success) {
+        factor = llt.matrixL();
+    } else {
+        SelfAdjointEigenSolver<MatrixXd> eig(covariance);
+        factor = eig.eigenvectors() * eig.eigenvalues().cwiseMax(0.0).cwiseSqrt().asDiagonal();
+    }
+
+    // Compound simulated days once up to the longest horizon, recording each horizon on the way
+    simulated.assign(horizons.size(), MatrixXd(N, num_scenarios));
+    const int64_t block_size = 4096;
+    int64_t num_blocks = (num_scenarios + block_size - 1) / block_size;
+    pool.parallel_for(num_blocks, [&](size_t block) {
+        int64_t offset = block * block_size;
+        int count = (int)min(block_size, num_scenarios - offset);
+        Philox::Stream rng(seed, block);
+        MatrixXd Z(N, count), step(N, count);
+        ArrayXXd growth = ArrayXXd::Ones(N, count);
+        size_t next = 0;
+        for (int t = 1; t <= horizons.back(); ++t) {
+            rng.normals(Z.data(), Z.size());
+            step.noalias() = factor * Z;
+            growth *= 1.0 + (step.colwise() + mean).array();
+            if (t == horizons[next]) simulated[next++].middleCols(offset, count) = (growth - 1.0).matrix();
+        }
+    });
+}
+
+// VaR and ES at every level from one sample (reordered in place). Levels
+// come in order of decreasing tail size k; after nth_element the first k
+// values are the tail, so the next level only partitions those.
+static void tail_risk(double *x, Index n, const vector<int>& order, const vector<double>& levels,
+                      double *var, double *es)
+{
+    if (n == 0) {
+        for (int l : order) var[l] = es[l] = NAN;
+        return;
+    }
+    Index limit = n;
+    for (int l : order) {
+        // Tail of ceil((1 - c) n) values; the epsilon keeps 1 - 0.95 from rounding up a whole rank
+        Index k = clamp<Index>((Index)ceil((1.0 - levels[l]) * n - 1e-9), 1, limit);
+        nth_element(x, x + k - 1, x + limit);
+        var[l] = -x[k - 1];
+        es[l] = -accumulate(x, x + k, 0.0) / k;
+        limit = k;
+    }
+}
+
+RiskReport RiskEngine::evaluate(const MatrixXd& candidates)
+{
+    int K = candidates.rows();
+    int L = levels.size();
+    int H = horizons.size();
+    assert(candidates.cols() == returns.rows() && "Weight dimension mismatch");
+
+    RiskReport report;
+    report.horizons = horizons;
+    report.levels = levels;
+    report.moments.resize(K, 4);
+    for (int m = 0; m < num_risk_methods; ++m) {
+        report.var[m].resize(K, H * L);
+        report.es[m].resize(K, H * L);
+    }
+
+    // Standard normal quantiles, densities and, for the Cornish-Fisher ES,
+    // midpoint nodes over each tail (1 - c) (i + 1/2) / nodes
+    const int nodes = 256;
+    ArrayXd alpha(L);
+    for (int l = 0; l < L; ++l) alpha(l) = 1.0 - levels[l];
+    ArrayXd z = Normal::inv_cdf(alpha);
+    ArrayXd z_density = Normal::pdf(z);
+    ArrayXXd z_tail(nodes, L);
+    for (int l = 0; l < L; ++l) {
+        z_tail.col(l) = Normal::inv_cdf((ArrayXd::LinSpaced(nodes, 0, nodes - 1) + 0.5) * alpha(l) / nodes);
+    }
+
+    int64_t num_chunks = (K + chunk_size - 1) / chunk_size;
+    pool.parallel_for(num_chunks, [&](size_t chunk) {
+        int first = chunk * chunk_size;
+        int count = min(chunk_size, K - first);
+        MatrixXd W = candidates.middleRows(first, count).transpose();   // N x count
+        vector<double> var(L), es(L);
+
+        // Daily moments of each portfolio for the parametric methods
+        MatrixXd P = returns.transpose() * W;
+        for (int j = 0; j < count; ++j) {
+            ArrayXd d = P.col(j).array() - P.col(j).mean();
+            double m2 = d.square().mean();
+            report.moments(first + j, 0) = P.col(j).mean();
+            report.moments(first + j, 1) = sqrt(d.square().sum() / (P.rows() - 1));
+            report.moments(first + j, 2) = m2 > 0.0 ? d.cube().mean() / pow(m2, 1.5) : 0.0;
+            report.moments(first + j, 3) = m2 > 0.0 ? d.square().square().mean() / (m2 * m2) - 3.0 : 0.0;
+        }
+
+        for (int h = 0; h < H; ++h) {
+            for (int method : {(int)RiskMethod::Historical, (int)RiskMethod::MonteCarlo}) {
+                const MatrixXd& X = method == (int)RiskMethod::Historical ? historical[h] : simulated[h];
+                P.noalias() = X.transpose() * W;    // samples x count, one portfolio per column
+
+                for (int j = 0; j < count; ++j) {
+                    tail_risk(P.col(j).data(), P.rows(), level_order, levels, var.data(), es.data());
+                    for (int l = 0; l < L; ++l) {
+                        report.var[method](first + j, h * L + l) = var[l];
+                        report.es[method](first + j, h * L + l) = es[l];
+                    }
+                }
+            }
+        }
+    });
+
+    // Moment-based methods need only the daily moments, scaled to each horizon
+    for (int k = 0; k < K; ++k) {
+        double mu = report.moments(k, 0), sigma = report.moments(k, 1);
+        double skew = report.moments(k, 2), kurt = report.moments(k, 3);
+        for (int h = 0; h < H; ++h) {
+            double mu_h = horizons[h] * mu, sigma_h = sqrt((double)horizons[h]) * sigma;
+            double s = skew / sqrt((double)horizons[h]), e = kurt / horizons[h];
+            auto cornish_fisher = [&](const ArrayXd& q) -> ArrayXd {
+                return q + (q.square() - 1.0) * s / 6.0 + (q.cube() - 3.0 * q) * e / 24.0
+                         - (2.0 * q.cube() - 5.0 * q) * s * s / 36.0;
+            };
+            ArrayXd z_cf = cornish_fisher(z);
+            for (int l = 0; l < L; ++l) {
+                int col = h * L + l;
+                report.var[(int)RiskMethod::Gaussian](k, col) = -(mu_h + z(l) * sigma_h);
+                report.es[(int)RiskMethod::Gaussian](k, col) = -(mu_h - sigma_h * z_density(l) / alpha(l));
+                report.var[(int)RiskMethod::CornishFisher](k, col) = -(mu_h + z_cf(l) * sigma_h);
+                report.es[(int)RiskMethod::CornishFisher](k, col) = -(mu_h + cornish_fisher(z_tail.col(l)).mean() * sigma_h);
+            }
+        }
+    }
+
+    return report;
+}
+
+ostream& operator<<(ostream& os, const RiskReport& report)
+{
+    static const char *method_names[num_risk_methods] = {"historical", "gaussian", "cornish-fisher", "monte carlo"};
+    int L = report.levels.size();
+
+    os << "Risk report (losses as fractions of initial value):" << endl;
+    for (Index k = 0; k < report.moments.rows(); ++k) {
+        os << " portfolio " << k << ": daily mean = " << report.moments(k, 0)
+           << ", std = " << report.moments(k, 1) << ", skewness = " << report.moments(k, 2)
+           << ", excess kurtosis = " << report.moments(k, 3) << endl;
+        os << "  " << left << setw(8) << "horizon" << setw(16) << "method";
+        for (double c : report.levels) {
+            os << right << setw(11) << ("VaR " + to_string((int)lround(100 * c)) + "%")
+               << setw(11) << ("ES " + to_string((int)lround(100 * c)) + "%");
+        }
+        os << endl;
+        for (size_t h = 0; h < report.horizons.size(); ++h) {
+            for (int m = 0; m < num_risk_methods; ++m) {
+                os << "  " << left << setw(8) << (to_string(report.horizons[h]) + "d") << setw(16) << method_names[m] << right;
+                for (int l = 0; l < L; ++l) {
+                    os << setw(11) << report.var[m](k, h * L + l) << setw(11) << report.es[m](k, h * L + l);
+                }
+                os << endl;
+            }
+        }
+    }
+    return os;
+}
@@ -1,4 +1,6 @@
+#include <bit>
 #include <iostream>
+#include <string>
 
 #include "market_data.hpp"
 
@@ -6,6 +8,27 @@ int main(int argc, char *argv[])
 {
     using namespace std;
 
+    // --paths sets the Monte Carlo path count (the 10M x 252 throughput target
+    // is --paths 10000000); --demo adds the sampler, variance reduction,
+    // rebalancing and bootstrap comparisons at that count; --cloud writes the
+    // random-portfolio cloud to a file, which is otherwise only summarized
+    int64_t num_paths = 100000;
+    bool demo = false;
+    std::string cloud_path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--paths" && i + 1 < argc) {
+            num_paths = std::stoll(argv[++i]);
+        } else if (arg == "--demo") {
+            demo = true;
+        } else if (arg == "--cloud" && i + 1 < argc) {
+            cloud_path = argv[++i];
+        } else {
+            cerr << "Usage: " << argv[0] << " [--paths N] [--demo] [--cloud PATH]" << endl;
+            return 1;
+        }
+    }
+
     std::string assets[] = {
         {"X:BTCUSD"},
         {"X:ETHUSD"}
@@ -25,8 +48,43 @@ int main(int argc, char *argv[])
     portfolio.optimize_sharpe(10);
     cout << portfolio << std::endl;
 
+    portfolio.optimize_sharpe_resampled();
+    cout << portfolio << std::endl;
+
     portfolio.optimize_omega();
     cout << portfolio << std::endl;
 
+    if (portfolio.optimize_omega_lp()) {
+        cout << portfolio << std::endl;
+    }
+    cout << portfolio.risk_report() << std::endl;
+
+    portfolio.sample_cloud(cloud_path);
+
+    cout << portfolio.simulate(num_paths, 252) << std::endl;
+    if (!demo) return 0;
+
+    // Sobol reaches its full rate at power-of-two path counts
+    cout << portfolio.simulate(std::bit_floor((uint64_t)num_paths), 252, 42, Sampler::Sobol) << std::endl;
+
+    VarianceReduction reduction;
+    reduction.antithetic = true;
+    reduction.control_variate = true;
+    reduction.stratified = true;
+    cout << portfolio.simulate(num_paths, 252, 42, Sampler::PseudoRandom, reduction) << std::endl;
+
+    RebalancePolicy monthly;
+    monthly.rule = Rebalance::Calendar;
+    monthly.period = 21;
+    monthly.cost = 0.001;
+    cout << portfolio.simulate(num_paths, 252, 42, Sampler::PseudoRandom, {}, monthly) << std::endl;
+
+    RebalancePolicy banded;
+    banded.rule = Rebalance::Threshold;
+    banded.band = 0.05;
+    banded.cost = 0.001;
+    cout << portfolio.simulate(num_paths, 252, 42, Sampler::PseudoRandom, {}, banded) << std::endl;
+    cout << portfolio.bootstrap(num_paths, 252) << std::endl;
+
     return 0;
 }
\ No newline at end of file
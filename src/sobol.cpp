@@ -0,0 +1,105 @@
+#include <bit>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+#include <Eigen/Dense>
+
+#include "sobol.hpp"
+#include "sobol_joe_kuo.hpp"
+
+using namespace std;
+using namespace Eigen;
+
+static uint64_t splitmix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+int SobolSequence::max_dimensions()
+{
+    return 1 + JoeKuo::dimensions;
+}
+
+SobolSequence::SobolSequence(int _dims, uint64_t seed)
+    : dims{_dims}, directions(_dims * 32), scramble_seeds(_dims)
+{
+    assert(dims <= max_dimensions() && "Sobol dimension exceeds the Joe-Kuo table");
+    const uint16_t *record = JoeKuo::table;
+
+    for (int j = 0; j < dims; ++j) {
+        uint32_t *v = directions.data() + j * 32;
+        scramble_seeds[j] = (uint32_t)splitmix64(seed ^ splitmix64(j));
+
+        if (j == 0) {
+            for (int k = 0; k < 32; ++k) v[k] = 1u << (31 - k);
+            continue;
+        }
+
+        int degree = record[0];
+        uint32_t inner = record[1];
+        const uint16_t *m = record + 2;
+        record += 2 + degree;
+
+        // v[k] holds direction number k + 1, i.e. m_{k+1} / 2^{k+1} in 32-bit fixed point
+        for (int k = 0; k < degree; ++k) v[k] = (uint32_t)m[k] << (31 - k);
+        for (int k = degree; k < 32; ++k) {
+            v[k] = v[k - degree] ^ (v[k - degree] >> degree);
+            for (int l = 1; l < degree; ++l) {
+                if (inner >> (degree - 1 - l) & 1) v[k] ^= v[k - l];
+            }
+        }
+    }
+}
+
+static inline uint32_t reverse_bits(uint32_t x)
+{
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Owen scramble: a hash that only lets each bit depend on the bits above it
+static inline uint32_t nested_uniform_scramble(uint32_t x, uint32_t seed)
+{
+    x = reverse_bits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverse_bits(x);
+}
+
+void SobolSequence::generate(uint64_t first, int count,
+                             Matrix<double, Dynamic, Dynamic, RowMajor>& U) const
+{
+    assert(first + count <= (1ull << 32) && "Sobol index range exceeds 2^32 points");
+    U.resize(dims, count);
+
+    // Bit flipped between consecutive Gray codes, shared by every dimension
+    vector<int> flip(count);
+    for (int i = 1; i < count; ++i) flip[i] = countr_zero(first + i);
+
+    uint32_t gray = (uint32_t)(first ^ (first >> 1));
+    for (int j = 0; j < dims; ++j) {
+        const uint32_t *v = directions.data() + j * 32;
+        uint32_t seed = scramble_seeds[j];
+
+        uint32_t x = 0;
+        for (int k = 0; k < 32; ++k) {
+            if (gray >> k & 1) x ^= v[k];
+        }
+
+        double *row = U.row(j).data();
+        for (int i = 0; i < count; ++i) {
+            if (i > 0) x ^= v[flip[i]];
+            // Midpoint of the 2^-32 cell keeps u strictly inside (0, 1)
+            row[i] = (nested_uniform_scramble(x, seed) + 0.5) * 0x1.0p-32;
+        }
+    }
+}
@@ -0,0 +1,194 @@
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <Eigen/Dense>
+
+#include "tdigest.hpp"
+
+using namespace std;
+using namespace Eigen;
+
+TDigest::TDigest(double _compression)
+    : compression{std::max(_compression, 10.0)}, buffer_capacity{(size_t)(5 * compression)},
+      min_value{numeric_limits<double>::infinity()}, max_value{-numeric_limits<double>::infinity()}
+{
+}
+
+// Chan et al. pairwise update of the exact count, mean and squared deviations
+void TDigest::add_moments(double weight, double mean, double sum_sq)
+{
+    double total = total_weight + weight;
+    double delta = mean - mean_value;
+    mean_value += delta * weight / total;
+    m2 += sum_sq + delta * delta * total_weight * weight / total;
+    total_weight = total;
+}
+
+void TDigest::add(double x, double weight)
+{
+    if (weight <= 0.0) return;
+    add_moments(weight, x, 0.0);
+    min_value = std::min(min_value, x);
+    max_value = std::max(max_value, x);
+    buffer.push_back({x, weight});
+    if (buffer.size() >= buffer_capacity) flush();
+}
+
+void TDigest::add(const double *x, Index n)
+{
+    if (n <= 0) return;
+    Map<const ArrayXd> values(x, n);
+    double batch_mean = values.mean();
+    add_moments(n, batch_mean, (values - batch_mean).square().sum());
+    min_value = std::min(min_value, values.minCoeff());
+    max_value = std::max(max_value, values.maxCoeff());
+
+    for (Index i = 0; i < n; ) {
+        Index m = std::min<Index>(n - i, buffer_capacity - buffer.size());
+        for (Index j = 0; j < m; ++j) buffer.push_back({x[i + j], 1.0});
+        i += m;
+        if (buffer.size() >= buffer_capacity) flush();
+    }
+}
+
+void TDigest::merge(const TDigest& other)
+{
+    if (other.total_weight <= 0.0) return;
+    add_moments(other.total_weight, other.mean_value, other.m2);
+    min_value = std::min(min_value, other.min_value);
+    max_value = std::max(max_value, other.max_value);
+
+    // The other digest's centroids are just weighted points to this one
+    buffer.insert(buffer.end(), other.centroids.begin(), other.centroids.end());
+    buffer.insert(buffer.end(), other.buffer.begin(), other.buffer.end());
+    if (buffer.size() >= buffer_capacity) flush();
+}
+
+void TDigest::flush() const
+{
+    if (buffer.empty()) return;
+
+    buffer.insert(buffer.end(), centroids.begin(), centroids.end());
+    sort(buffer.begin(), buffer.end(), [](const Centroid& a, const Centroid& b) { return a.mean < b.mean; });
+    centroids.clear();
+
+    // Greedy merge in order of value: the open centroid absorbs the next
+    // point while its upper rank stays below q_limit, one unit of k above
+    // where it started
+    double scale = compression / (2.0 * M_PI);
+    auto k_of_q = [&](double q) { return scale * asin(2.0 * std::clamp(q, 0.0, 1.0) - 1.0); };
+    auto q_of_k = [&](double k) { return k >= scale * M_PI / 2 ? 1.0 : 0.5 * (sin(k / scale) + 1.0); };
+
+    double n = total_weight;
+    double done = 0.0;
+    Centroid open = buffer[0];
+    double limit = n * q_of_k(k_of_q(0.0) + 1.0);
+    for (size_t i = 1; i < buffer.size(); ++i) {
+        const Centroid& next = buffer[i];
+        if (done + open.weight + next.weight <= limit) {
+            open.weight += next.weight;
+            open.mean += (next.mean - open.mean) * next.weight / open.weight;
+        } else {
+            done += open.weight;
+            centroids.push_back(open);
+            limit = n * q_of_k(k_of_q(done / n) + 1.0);
+            open = next;
+        }
+    }
+    centroids.push_back(open);
+    buffer.clear();
+}
+
+void TDigest::compress()
+{
+    flush();
+    buffer.shrink_to_fit();
+}
+
+size_t TDigest::num_centroids() const
+{
+    flush();
+    return centroids.size();
+}
+
+void TDigest::knots(vector<double>& rank, vector<double>& value) const
+{
+    flush();
+    rank.assign(1, 0.0);
+    value.assign(1, min_value);
+    double cumulative = 0.0;
+    for (const Centroid& c : centroids) {
+        rank.push_back(cumulative + 0.5 * c.weight);
+        value.push_back(c.mean);
+        cumulative += c.weight;
+    }
+    rank.push_back(total_weight);
+    value.push_back(max_value);
+}
+
+double TDigest::quantile(double q) const
+{
+    if (total_weight <= 0.0) return numeric_limits<double>::quiet_NaN();
+    vector<double> rank, value;
+    knots(rank, value);
+
+    double r = std::clamp(q, 0.0, 1.0) * total_weight;
+    size_t j = upper_bound(rank.begin(), rank.end(), r) - rank.begin();
+    if (j == 0) return value.front();
+    if (j == rank.size()) return value.back();
+    double span = rank[j] - rank[j - 1];
+    double t = span > 0.0 ? (r - rank[j - 1]) / span : 0.0;
+    return value[j - 1] + t * (value[j] - value[j - 1]);
+}
+
+// Rank of x on the piecewise-linear quantile function through the knots
+static double rank_of(const vector<double>& rank, const vector<double>& value, double x)
+{
+    if (x < value.front()) return 0.0;
+    if (x >= value.back()) return rank.back();
+
+    // Values are nondecreasing along the knots; take the last segment starting at or below x
+    size_t j = upper_bound(value.begin(), value.end(), x) - value.begin();
+    double span = value[j] - value[j - 1];
+    double t = span > 0.0 ? (x - value[j - 1]) / span : 0.0;
+    return rank[j - 1] + t * (rank[j] - rank[j - 1]);
+}
+
+double TDigest::cdf(double x) const
+{
+    if (total_weight <= 0.0) return numeric_limits<double>::quiet_NaN();
+    vector<double> rank, value;
+    knots(rank, value);
+    return rank_of(rank, value, x) / total_weight;
+}
+
+double TDigest::tail_mean(double q) const
+{
+    if (total_weight <= 0.0 || q <= 0.0) return numeric_limits<double>::quiet_NaN();
+    vector<double> rank, value;
+    knots(rank, value);
+
+    // Integral of the quantile function over ranks [0, R], segment by segment
+    double R = std::min(q, 1.0) * total_weight;
+    double area = 0.0;
+    for (size_t j = 1; j < rank.size() && rank[j - 1] < R; ++j) {
+        double end = std::min(rank[j], R);
+        double span = rank[j] - rank[j - 1];
+        double v_end = span > 0.0 ? value[j - 1] + (end - rank[j - 1]) / span * (value[j] - value[j - 1]) : value[j];
+        area += (end - rank[j - 1]) * 0.5 * (value[j - 1] + v_end);
+    }
+    return area / R;
+}
+
+VectorXd TDigest::histogram(const VectorXd& edges) const
+{
+    VectorXd counts = VectorXd::Zero(std::max<Index>(edges.size() - 1, 0));
+    if (total_weight <= 0.0) return counts;
+    vector<double> rank, value;
+    knots(rank, value);
+    for (Index j = 0; j < counts.size(); ++j) {
+        counts(j) = rank_of(rank, value, edges(j + 1)) - rank_of(rank, value, edges(j));
+    }
+    return counts;
+}